@@ -0,0 +1,314 @@
+/*
+ * GBM Bench - Host-native throughput benchmark for the GBM decoder core
+ *
+ * Decodes a whole .gbm file with source/gbm_decoder.c built natively
+ * (GBM_HOST_BUILD) and reports per-frame decode timing. After every frame
+ * the dirty macroblocks are copied into the reference buffer, mirroring
+ * copy_dirty_to_vram() on hardware; that copy is not timed. A dirty map
+ * that misses a changed block leaves a stale reference and changes the
+ * checksum.
+ *
+ * With -b the frame is decoded through gbm_decode_frame_banded() into two
+ * band buffers that are written back into the reference one row late, as
+ * the band path in main.c does with VRAM; the write-back is timed with the
+ * decode since it is interleaved with it.
+ *
+ * With -q the frames are decoded through gbm_decode_frame_paged() into a
+ * ring of whole frames, each referencing the one before, as the player's
+ * frame queue does; -f is a ring of two, the Mode 5 page-flip path.
+ * Nothing is copied between frames.
+ *
+ * Usage:
+ *   gbm_bench [-p passes] [-b | -f | -q n] [-v] input.gbm
+ *     -p passes   decode the file this many times (default 1)
+ *     -b          band mode
+ *     -f          page-flip mode
+ *     -q n        frame queue of n frames (2 to MAX_RING)
+ *     -v          print a checksum for every frame
+ *
+ * The final checksum covers every decoded frame, so it can be compared
+ * across decoder changes to confirm bit-identical output.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "gbm_decoder.h"
+
+#define FRAME_PIXELS (FRAME_WIDTH * FRAME_HEIGHT)
+
+static u16 frame_buffer[FRAME_PIXELS];
+static u16 ref_buffer[FRAME_PIXELS];
+static u32 dirty_rows[GBM_MB_ROWS];
+
+// Frame size from the header (stride = width)
+static int width = FRAME_WIDTH;
+static int mb_cols = GBM_MB_COLS;
+static int mb_rows = GBM_MB_ROWS;
+
+#define MAX_RING 4
+
+static u16 ring[MAX_RING][FRAME_PIXELS];
+static u32 ring_dirty[MAX_RING][GBM_MB_ROWS];
+
+static u16 bands[2][GBM_BAND_PIXELS];
+static u16 *const band_ptrs[2] = { bands[0], bands[1] };
+static u32 pending_dirty;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// FNV-1a, continued across frames
+static uint32_t checksum_update(uint32_t hash, const u16* pixels, size_t count) {
+    const uint8_t* p = (const uint8_t*)pixels;
+    for (size_t i = 0; i < count * 2; i++) {
+        hash ^= p[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// Host stand-in for the display step: copy dirty macroblocks into ref.
+// Returns the number of dirty macroblocks.
+static uint32_t copy_dirty_blocks(void) {
+    uint32_t count = 0;
+    for (int y = 0; y < mb_rows; y++) {
+        for (int x = 0; x < mb_cols; x++) {
+            if (!(dirty_rows[y] & (1u << x))) continue;
+            count++;
+            for (int line = 0; line < 8; line++) {
+                size_t pos = (size_t)(y * 8 + line) * width + x * 8;
+                memcpy(ref_buffer + pos, frame_buffer + pos, 8 * sizeof(u16));
+            }
+        }
+    }
+    return count;
+}
+
+// Band mode: copy the dirty macroblocks of row y_block back into ref
+static void write_band(int y_block, u32 dirty) {
+    const u16 *band = bands[y_block & 1];
+    dirty_rows[y_block] = dirty;
+    for (int x = 0; x < mb_cols; x++) {
+        if (!(dirty & (1u << x))) continue;
+        for (int line = 0; line < 8; line++) {
+            size_t pos = (size_t)line * width + x * 8;
+            memcpy(ref_buffer + (size_t)y_block * 8 * width + pos, band + pos, 8 * sizeof(u16));
+        }
+    }
+}
+
+static void band_row_done(int y_block, u32 dirty) {
+    if (y_block > 0) {
+        write_band(y_block - 1, pending_dirty);
+    }
+    pending_dirty = dirty;
+}
+
+static uint32_t count_dirty_blocks(void) {
+    uint32_t count = 0;
+    for (int y = 0; y < mb_rows; y++) {
+        count += __builtin_popcount(dirty_rows[y]);
+    }
+    return count;
+}
+
+static int compare_u64(const void* a, const void* b) {
+    uint64_t x = *(const uint64_t*)a;
+    uint64_t y = *(const uint64_t*)b;
+    return (x > y) - (x < y);
+}
+
+static uint8_t* load_file(const char* path, uint32_t* size) {
+    FILE* f = fopen(path, "rb");
+    if (!f) return NULL;
+
+    fseek(f, 0, SEEK_END);
+    long len = ftell(f);
+    fseek(f, 0, SEEK_SET);
+
+    uint8_t* data = malloc(len > 0 ? len : 1);
+    if (data && fread(data, 1, len, f) != (size_t)len) {
+        free(data);
+        data = NULL;
+    }
+    fclose(f);
+
+    *size = (uint32_t)len;
+    return data;
+}
+
+static void print_usage(const char* prog) {
+    fprintf(stderr, "Usage: %s [-p passes] [-b | -f | -q n] [-v] input.gbm\n", prog);
+}
+
+int main(int argc, char** argv) {
+    const char* input_path = NULL;
+    int passes = 1;
+    int verbose = 0;
+    int band_mode = 0;
+    int ring_size = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-p") == 0 && i + 1 < argc) {
+            passes = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-b") == 0) {
+            band_mode = 1;
+        } else if (strcmp(argv[i], "-f") == 0) {
+            ring_size = 2;
+        } else if (strcmp(argv[i], "-q") == 0 && i + 1 < argc) {
+            ring_size = atoi(argv[++i]);
+            if (ring_size < 2 || ring_size > MAX_RING) {
+                print_usage(argv[0]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "-v") == 0) {
+            verbose = 1;
+        } else {
+            input_path = argv[i];
+        }
+    }
+
+    if (!input_path || passes <= 0) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    uint32_t size = 0;
+    uint8_t* data = load_file(input_path, &size);
+    if (!data) {
+        fprintf(stderr, "Error: Cannot read %s\n", input_path);
+        return 1;
+    }
+
+    if (size < GBM_HEADER_SIZE || memcmp(data, "GBAM", 4) != 0) {
+        fprintf(stderr, "Error: %s is not a GBM file\n", input_path);
+        free(data);
+        return 1;
+    }
+
+    gbm_set_version(data[0x10]);
+
+    u16 frame_w, frame_h;
+    gbm_get_frame_size(data, &frame_w, &frame_h);
+    if (!gbm_set_frame_size(frame_w, frame_h)) {
+        fprintf(stderr, "Error: unsupported frame size %ux%u\n", frame_w, frame_h);
+        free(data);
+        return 1;
+    }
+    width = frame_w;
+    mb_cols = frame_w / 8;
+    mb_rows = frame_h / 8;
+    size_t frame_pixels = (size_t)frame_w * frame_h;
+
+    // Count frames up front so timings can be stored without reallocating
+    uint32_t frame_count = 0;
+    for (uint32_t offset = GBM_HEADER_SIZE; offset + 2 < size; frame_count++) {
+        uint16_t frame_len = data[offset] | (data[offset + 1] << 8);
+        if (frame_len == 0 || frame_len == 0xFFFF) break;
+        offset += 2 + frame_len;
+    }
+
+    if (frame_count == 0) {
+        fprintf(stderr, "Error: %s contains no frames\n", input_path);
+        free(data);
+        return 1;
+    }
+
+    uint64_t* timings = malloc(sizeof(uint64_t) * frame_count * passes);
+    if (!timings) {
+        free(data);
+        return 1;
+    }
+
+    uint32_t checksum = 2166136261u;
+    uint64_t bytes_consumed = 0;
+    uint64_t dirty_blocks = 0;
+    uint32_t decoded = 0;
+
+    for (int pass = 0; pass < passes; pass++) {
+        memset(frame_buffer, 0, sizeof(frame_buffer));
+        memset(ref_buffer, 0, sizeof(ref_buffer));
+        memset(ring, 0, sizeof(ring));
+        memset(ring_dirty, 0, sizeof(ring_dirty));
+        int newest = 0;
+
+        uint32_t offset = GBM_HEADER_SIZE;
+        for (uint32_t f = 0; f < frame_count; f++) {
+            uint64_t start = now_ns();
+            uint32_t next;
+            if (band_mode) {
+                next = gbm_decode_frame_banded(data, offset, band_ptrs, ref_buffer, band_row_done);
+                write_band(mb_rows - 1, pending_dirty);
+            } else if (ring_size) {
+                // The slot is stale wherever another slot's decode wrote
+                int slot = newest + 1 == ring_size ? 0 : newest + 1;
+                u32 stale[GBM_MB_ROWS] = {0};
+                for (int i = 0; i < ring_size; i++) {
+                    if (i == slot) continue;
+                    for (int y = 0; y < GBM_MB_ROWS; y++) stale[y] |= ring_dirty[i][y];
+                }
+                next = gbm_decode_frame_paged(data, offset, ring[slot], ring[newest],
+                                              stale, ring_dirty[slot]);
+                newest = slot;
+            } else {
+                next = gbm_decode_frame(data, offset, frame_buffer, ref_buffer, dirty_rows);
+            }
+            timings[decoded++] = now_ns() - start;
+
+            bytes_consumed += next - offset;
+            offset = next;
+
+            // Display step: the decoded frame becomes the next reference
+            // (band mode has already written it back, a ring just moves on)
+            const u16 *shown = frame_buffer;
+            if (band_mode) {
+                dirty_blocks += count_dirty_blocks();
+                shown = ref_buffer;
+            } else if (ring_size) {
+                memcpy(dirty_rows, ring_dirty[newest], sizeof(dirty_rows));
+                dirty_blocks += count_dirty_blocks();
+                shown = ring[newest];
+            } else {
+                dirty_blocks += copy_dirty_blocks();
+            }
+
+            if (pass == 0) {
+                uint32_t frame_hash = checksum_update(2166136261u, shown, frame_pixels);
+                checksum = checksum_update(checksum, shown, frame_pixels);
+                if (verbose) {
+                    printf("frame %5u: %08x\n", f, frame_hash);
+                }
+            }
+        }
+    }
+
+    uint64_t total_ns = 0;
+    for (uint32_t i = 0; i < decoded; i++) total_ns += timings[i];
+    qsort(timings, decoded, sizeof(uint64_t), compare_u64);
+
+    double mean_us = (double)total_ns / decoded / 1000.0;
+    double p99_us = timings[(decoded * 99) / 100 < decoded ? (decoded * 99) / 100 : decoded - 1] / 1000.0;
+    double max_us = timings[decoded - 1] / 1000.0;
+    double fps = total_ns ? (double)decoded * 1e9 / (double)total_ns : 0.0;
+
+    printf("File:      %s (version 0x%02x, %ux%u)\n", input_path, data[0x10], frame_w, frame_h);
+    printf("Frames:    %u x %d pass(es)\n", frame_count, passes);
+    printf("Bytes:     %llu consumed of %u per pass\n",
+           (unsigned long long)(bytes_consumed / passes), size - GBM_HEADER_SIZE);
+    printf("Dirty:     %.1f%% of macroblocks copied to VRAM\n",
+           100.0 * dirty_blocks / ((double)decoded * mb_cols * mb_rows));
+    printf("Speed:     %.1f frames/s\n", fps);
+    printf("Per frame: mean %.2f us, p99 %.2f us, max %.2f us\n", mean_us, p99_us, max_us);
+    printf("Checksum:  %08x\n", checksum);
+
+    free(timings);
+    free(data);
+    return 0;
+}
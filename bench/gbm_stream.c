@@ -0,0 +1,374 @@
+/*
+ * GBM Stream - Play a movie through the streaming media source on a
+ * simulated block device, to size the read-ahead cache
+ *
+ * Includes source/gbs_audio.c (GBS_HOST_BUILD, GBS_AUDIO_STATS) and links
+ * source/media_stream.c and the GBM decoder, built natively. The movie and
+ * a synthetic ADPCM .gbs of the same length are written to a temporary
+ * file, which stands in for the card: each read command costs latency_us
+ * plus the transfer at the given rate on a simulated clock, and Timer1 IRQs
+ * that fall due during a read run inside it, as on hardware.
+ *
+ * The main loop is modelled on main.c in band mode: at each VBlank a due
+ * frame is staged (media_stream_stage_frame) and decoded, costing
+ * decode_ms of CPU spread over its macroblock rows with the audio ring
+ * topped up after each row, then the ring is topped up again and one chunk
+ * is read ahead (media_stream_prefetch). The video loops at its end, the audio
+ * loops on its own.
+ *
+ * Checked against the same media played from memory: every staged frame
+ * must match the file and decode to the same pictures, and every audio
+ * buffer on air must match. Reported, and failures: frames shown over a
+ * frame period late, audio blocks replayed because the IRQ found the block
+ * not cached, audio underruns, and more than MAX_IRQ_DECODES buffers
+ * decoded in the Timer1 IRQ - each holds off every interrupt for a whole
+ * buffer decode.
+ *
+ * The cache geometry is the player's build options; try others with
+ *   make -C bench stream STREAM_FLAGS="-DMEDIA_CACHE_CHUNKS=4 -DMEDIA_CHUNK_SIZE=4096"
+ *
+ * Usage:
+ *   gbm_stream [-l latency_us] [-r KB/s] [-d decode_ms] [-m mode] [-t minutes] movie.gbm
+ *     -l latency_us  cost of each read command (default 1000)
+ *     -r KB/s        transfer rate (default 1024)
+ *     -d decode_ms   CPU time to decode a frame (default 40)
+ *     -m mode        GBS mode 0-4 of the synthetic audio (default 0)
+ *     -t minutes     time to play, looping the movie (default: one pass)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <unistd.h>
+
+#include "../source/gbs_audio.c"
+#include "gbs_fixture.h"
+#include "gbm_decoder.h"
+#include "media_stream.h"
+
+#define FRAME_PIXELS    (FRAME_WIDTH * FRAME_HEIGHT)
+#define VIDEO_FPS       10
+#define FRAME_US        (1000000.0 / VIDEO_FPS)
+#define VBLANK_US       (280896 * 1000000.0 / GBA_MASTER_CLOCK)
+
+// Where the files go on the device: not sector aligned, as in GBFS
+#define GBM_DEVICE_OFFSET 0x40
+
+// Buffers the Timer1 IRQ may decode itself over a run
+#define MAX_IRQ_DECODES 2
+
+// ============================================================================
+// Simulated device
+// ============================================================================
+
+static int device_fd = -1;
+static double latency_us = 1000.0;
+static double rate_kbs = 1024.0;
+
+static double now_us;               // Simulated time
+static double device_us;            // Of which spent in device reads
+static double next_irq_us;          // Next Timer1 IRQ (buffer boundary)
+static double buffer_us;
+static bool in_irq;
+
+// Audio buffers heard, and their checksums from memory playback
+static uint32_t* expected_buffers;
+static uint32_t buffer_count;
+static uint32_t buffers_heard;
+static uint32_t audio_mismatches;
+
+// FNV-1a
+static uint32_t checksum_update(uint32_t hash, const void* data, size_t size) {
+    const uint8_t* p = data;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= p[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// The buffer now on air
+static uint32_t buffer_checksum(void) {
+    uint32_t hash = checksum_update(2166136261u, state.slot_left[state.play_buffer],
+                                    state.info.buffer_samples);
+    if (state.info.channels == 2) {
+        hash = checksum_update(hash, state.slot_right[state.play_buffer], state.info.buffer_samples);
+    }
+    return hash;
+}
+
+// Run the Timer1 IRQs that have fallen due
+static void service_irqs(void) {
+    while (!in_irq && now_us >= next_irq_us) {
+        in_irq = true;
+        host_irq_raise(IRQ_TIMER1);
+        if (buffers_heard < buffer_count &&
+            buffer_checksum() != expected_buffers[buffers_heard]) {
+            audio_mismatches++;
+        }
+        buffers_heard++;
+        next_irq_us += buffer_us;
+        in_irq = false;
+    }
+}
+
+static bool file_read(uint32_t sector, uint32_t count, void* dst) {
+    uint32_t bytes = count * MEDIA_SECTOR_SIZE;
+    double cost = latency_us + bytes * 1000000.0 / (rate_kbs * 1024.0);
+    now_us += cost;
+    device_us += cost;
+    service_irqs();
+
+    memset(dst, 0, bytes);
+    return pread(device_fd, dst, bytes, (off_t)sector * MEDIA_SECTOR_SIZE) >= 0;
+}
+
+static MediaBlockDevice file_device = { file_read, 0 };
+
+// ============================================================================
+// Media
+// ============================================================================
+
+// Random ADPCM of at least seconds
+static uint8_t* make_gbs(int mode, double seconds, uint32_t* size) {
+    const GbsModeOps* ops = &gbs_modes[mode];
+    uint32_t blocks = (uint32_t)(seconds * ops->sample_rate / ops->samples_per_block) + 1;
+    return make_random_gbs(mode, blocks, ops->block_size, ops->block_header_size, size);
+}
+
+// Checksums of the first count buffers played from memory
+static uint32_t* play_from_memory(const uint8_t* gbs, uint32_t size, uint32_t count) {
+    uint32_t* sums = malloc(count * sizeof(uint32_t));
+    if (!sums || !gbs_audio_init(gbs, size)) {
+        free(sums);
+        return NULL;
+    }
+    gbs_audio_set_loop(true);
+    gbs_audio_start();
+    for (uint32_t i = 0; i < count; i++) {
+        gbs_audio_update();
+        host_irq_raise(IRQ_TIMER1);
+        sums[i] = buffer_checksum();
+    }
+    gbs_audio_shutdown();
+    return sums;
+}
+
+// ============================================================================
+// Video
+// ============================================================================
+
+// A decoder chain: frame buffer, reference and dirty map, as gbm_bench
+typedef struct {
+    u16 frame[FRAME_PIXELS];
+    u16 ref[FRAME_PIXELS];
+    u32 dirty[GBM_MB_ROWS];
+    uint32_t hash;
+} Decoder;
+
+static Decoder from_stream;
+static Decoder from_memory;
+
+static void decode(Decoder* d, const u8* data, u32 offset, u16 width, u16 height) {
+    gbm_decode_frame(data, offset, d->frame, d->ref, d->dirty);
+    for (int y = 0; y < height / 8; y++) {
+        for (int x = 0; x < width / 8; x++) {
+            if (!(d->dirty[y] & (1u << x))) continue;
+            for (int line = 0; line < 8; line++) {
+                size_t pos = (size_t)(y * 8 + line) * width + x * 8;
+                memcpy(d->ref + pos, d->frame + pos, 8 * sizeof(u16));
+            }
+        }
+    }
+    d->hash = checksum_update(d->hash, d->ref, (size_t)width * height * sizeof(u16));
+}
+
+// Frames in the movie
+static uint32_t count_frames(const uint8_t* gbm, uint32_t size) {
+    uint32_t frames = 0;
+    for (uint32_t offset = GBM_HEADER_SIZE; offset + 2 < size; frames++) {
+        uint32_t len = gbm[offset] | (gbm[offset + 1] << 8);
+        if (len == 0 || len == 0xFFFF || offset + 2 + len > size) break;
+        offset += 2 + len;
+    }
+    return frames;
+}
+
+int main(int argc, char** argv) {
+    double decode_ms = 40.0;
+    double minutes = 0.0;
+    int mode = GBS_MODE_STEREO_4BIT;
+    const char* path = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 < argc && strcmp(argv[i], "-l") == 0) {
+            latency_us = atof(argv[++i]);
+        } else if (i + 1 < argc && strcmp(argv[i], "-r") == 0) {
+            rate_kbs = atof(argv[++i]);
+        } else if (i + 1 < argc && strcmp(argv[i], "-d") == 0) {
+            decode_ms = atof(argv[++i]);
+        } else if (i + 1 < argc && strcmp(argv[i], "-m") == 0) {
+            mode = atoi(argv[++i]);
+        } else if (i + 1 < argc && strcmp(argv[i], "-t") == 0) {
+            minutes = atof(argv[++i]);
+        } else if (!path && argv[i][0] != '-') {
+            path = argv[i];
+        } else {
+            path = NULL;
+            break;
+        }
+    }
+    if (!path || mode < 0 || mode >= GBS_MODE_PCM8_MONO || rate_kbs <= 0) {
+        fprintf(stderr, "Usage: %s [-l latency_us] [-r KB/s] [-d decode_ms] [-m mode 0-4] [-t minutes] movie.gbm\n",
+                argv[0]);
+        return 1;
+    }
+
+    uint32_t gbm_size;
+    uint8_t* gbm = load_file(path, &gbm_size);
+    if (!gbm || gbm_size < GBM_HEADER_SIZE || memcmp(gbm, "GBAM", 4) != 0) {
+        fprintf(stderr, "Error: %s is not a GBM file\n", path);
+        return 1;
+    }
+    u16 width, height;
+    gbm_get_frame_size(gbm, &width, &height);
+    gbm_set_version(gbm[0x10]);
+    if (!gbm_set_frame_size(width, height)) {
+        fprintf(stderr, "Error: unsupported frame size %ux%u\n", width, height);
+        return 1;
+    }
+
+    uint32_t frames = count_frames(gbm, gbm_size);
+    double seconds = frames / (double)VIDEO_FPS;
+    double play_us = minutes > 0 ? minutes * 60e6 : seconds * 1e6;
+
+    uint32_t gbs_size;
+    uint8_t* gbs = make_gbs(mode, seconds, &gbs_size);
+    if (frames == 0 || !gbs) {
+        fprintf(stderr, "Error: no frames in %s\n", path);
+        return 1;
+    }
+
+    // The card: the movie, then the audio
+    uint32_t gbs_offset = (GBM_DEVICE_OFFSET + gbm_size + 15) & ~15u;
+    FILE* image = tmpfile();
+    if (!image || fseek(image, GBM_DEVICE_OFFSET, SEEK_SET) != 0 ||
+        fwrite(gbm, 1, gbm_size, image) != gbm_size || fseek(image, gbs_offset, SEEK_SET) != 0 ||
+        fwrite(gbs, 1, gbs_size, image) != gbs_size || fflush(image) != 0) {
+        fprintf(stderr, "Error: cannot write the device image\n");
+        return 1;
+    }
+    device_fd = fileno(image);
+    file_device.sector_count = (gbs_offset + gbs_size + MEDIA_SECTOR_SIZE - 1) / MEDIA_SECTOR_SIZE;
+
+    // What the audio should sound like
+    GbsAudioInfo info;
+    gbs_audio_probe(gbs, gbs_size, &info);
+    uint32_t buffer_samples = choose_buffer_samples(info.sample_rate, 0);
+    buffer_us = buffer_samples * 1e6 / info.sample_rate;
+    buffer_count = (uint32_t)(play_us / buffer_us) + 1;
+    expected_buffers = play_from_memory(gbs, gbs_size, buffer_count);
+    if (!expected_buffers) {
+        fprintf(stderr, "Error: cannot play the audio from memory\n");
+        return 1;
+    }
+
+    // Streams open as in main.c: audio first. No IRQs until it starts.
+    next_irq_us = INFINITY;
+    MediaStream audio, video;
+    if (!media_stream_mount(&file_device) ||
+        !media_stream_open_gbs(&audio, gbs_offset, gbs_size) ||
+        !media_stream_open(&video, GBM_DEVICE_OFFSET, gbm_size)) {
+        fprintf(stderr, "Error: cannot open the streams\n");
+        return 1;
+    }
+    gbs_audio_set_loop(true);
+    gbs_audio_reset_stats();
+    gbs_audio_start();
+    now_us = 0.0;
+    device_us = 0.0;
+    next_irq_us = buffer_us;
+
+    uint32_t offset = GBM_HEADER_SIZE;
+    uint32_t shown = 0;
+    uint32_t late = 0;
+    uint32_t data_errors = 0;
+    double worst_late_us = 0.0;
+    double worst_stage_us = 0.0;
+
+    while (now_us < play_us) {
+        // A frame is due: stage it from the stream and decode it
+        double due = shown * FRAME_US;
+        if (now_us >= due) {
+            double start = now_us;
+            const u8* frame = media_stream_stage_frame(&video, offset);
+            if (!frame) {
+                offset = GBM_HEADER_SIZE;   // Loop the movie
+                frame = media_stream_stage_frame(&video, offset);
+            }
+            if (!frame) {
+                fprintf(stderr, "Error: cannot stage the frame at 0x%X\n", offset);
+                return 1;
+            }
+            if (now_us - start > worst_stage_us) worst_stage_us = now_us - start;
+
+            uint32_t len = frame[0] | (frame[1] << 8);
+            if (memcmp(frame, gbm + offset, 2 + len) != 0) data_errors++;
+            decode(&from_stream, frame, 0, width, height);
+            decode(&from_memory, gbm, offset, width, height);
+            offset += 2 + len;
+
+            // band_row_done(): top up the audio after each row
+            for (int row = 0; row < height / 8; row++) {
+                now_us += decode_ms * 1000.0 / (height / 8);
+                service_irqs();
+                gbs_audio_update();
+                service_irqs();
+            }
+            if (now_us - due > worst_late_us) worst_late_us = now_us - due;
+            if (now_us - due > FRAME_US) late++;
+            shown++;
+        }
+
+        // wait_vblank(): top up the audio, read ahead, sleep
+        gbs_audio_update();
+        service_irqs();
+        media_stream_prefetch();
+        service_irqs();
+        now_us = (floor(now_us / VBLANK_US) + 1) * VBLANK_US;
+        service_irqs();
+    }
+
+    MediaStreamStats stream_stats;
+    media_stream_get_stats(&stream_stats);
+    GbsAudioStats audio_stats;
+    gbs_audio_get_stats(&audio_stats);
+    bool pictures_match = from_stream.hash == from_memory.hash;
+    uint32_t lookups = stream_stats.hits + stream_stats.misses;
+
+    printf("Cache %u x %u KB, read-ahead %u chunks; device %.0f us + %.0f KB/s, decode %.0f ms/frame\n",
+           MEDIA_CACHE_CHUNKS, MEDIA_CHUNK_SIZE / 1024, MEDIA_READAHEAD_CHUNKS,
+           latency_us, rate_kbs, decode_ms);
+    printf("  %.1f min played, device busy %.1f%%: %u reads (%u read ahead), %.1f MB, %.1f%% hits\n",
+           now_us / 60e6, device_us * 100.0 / now_us, stream_stats.device_reads,
+           stream_stats.prefetches, stream_stats.device_bytes / 1048576.0,
+           lookups ? stream_stats.hits * 100.0 / lookups : 0.0);
+    printf("  video: %u frames, %u late (worst %.1f ms after due, staging %.1f ms), %s\n",
+           shown, late, worst_late_us / 1000.0, worst_stage_us / 1000.0,
+           data_errors == 0 && pictures_match ? "data ok" : "DATA MISMATCH");
+    printf("  audio: %u buffers, %u blocks replayed, %u underruns, %u IRQ decodes, %u buffers differ\n",
+           buffers_heard, stream_stats.audio_replays, audio_stats.underruns,
+           audio_stats.irq_decodes, audio_mismatches);
+
+    // Any of these is heard or seen
+    bool glitches = late > 0 || stream_stats.audio_replays > 0 || audio_stats.underruns > 0;
+    bool failed = data_errors > 0 || !pictures_match || glitches ||
+                  audio_stats.irq_decodes > MAX_IRQ_DECODES || audio_mismatches > 0;
+    printf("  %s\n", failed ? "FAIL" : "ok");
+
+    fclose(image);
+    free(expected_buffers);
+    free(gbs);
+    free(gbm);
+    return failed;
+}
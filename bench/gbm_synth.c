@@ -0,0 +1,294 @@
+/*
+ * GBM Synth - Generate synthetic .gbm streams for the host benchmark
+ *
+ * Emits a valid GBM bitstream that exercises every block shape and opcode
+ * of the decoder. Real encodes only come out of the M3 converter (Windows),
+ * so this gives reproducible input with a tunable mix of static and
+ * subdivided blocks.
+ *
+ * Usage:
+ *   gbm_synth [options] output.gbm
+ *     -n frames    number of frames (default 600)
+ *     -s percent   chance a block is left unchanged (default 50)
+ *     -d percent   chance a splittable block subdivides (default 30)
+ *     -v version   GBM version byte, 4/5/6 (default 6)
+ *     -r seed      random seed (default 1)
+ *     -w width     frame width, multiple of 8 (default 240)
+ *     -h height    frame height, multiple of 8 (default 160)
+ *
+ * Sizes other than 240x160 are written with the "SIZE" header tag the
+ * player uses for the 160x128 Mode 5 profile.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#define GBM_HEADER_SIZE 0x200
+#define GBM_SIZE_TAG_OFFSET 0x1F0
+
+// Worst case per frame is every 8x8 split down to 1x2/2x1 - keep generous
+#define MAX_STREAM_BYTES (256 * 1024)
+
+typedef struct {
+    uint32_t words[MAX_STREAM_BYTES / 4];
+    uint32_t word_count;
+    int bit_pos;            // Next bit to write in current word (31 = MSB)
+
+    uint8_t palette[MAX_STREAM_BYTES];
+    uint32_t palette_len;
+
+    uint8_t payload[MAX_STREAM_BYTES];
+    uint32_t payload_len;
+} FrameStreams;
+
+static FrameStreams streams;
+static uint32_t rng_state = 1;
+static int static_percent = 50;
+static int split_percent = 30;
+static int frame_width = 240;
+static int frame_height = 160;
+
+static uint32_t rng_next(void) {
+    // xorshift32
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state;
+}
+
+static int rng_percent(int percent) {
+    return (int)(rng_next() % 100) < percent;
+}
+
+static void put_bit(int bit) {
+    if (streams.bit_pos < 0) {
+        streams.word_count++;
+        streams.bit_pos = 31;
+    }
+    if (bit) streams.words[streams.word_count - 1] |= 1u << streams.bit_pos;
+    streams.bit_pos--;
+}
+
+static void put_2bits(int bits) {
+    put_bit(bits >> 1);
+    put_bit(bits & 1);
+}
+
+static void put_color(uint16_t color) {
+    streams.palette[streams.palette_len++] = color & 0xFF;
+    streams.palette[streams.palette_len++] = color >> 8;
+}
+
+// Pick a codebook entry whose reference rectangle stays inside the frame.
+// Codebook index = (dy + 8) * 16 + (dx + 8), dx/dy in [-8, 7] pixels.
+static void put_code(int x, int y, int w, int h) {
+    for (int tries = 0; tries < 8; tries++) {
+        int dx = (int)(rng_next() & 15) - 8;
+        int dy = (int)(rng_next() & 15) - 8;
+        if (x + dx >= 0 && x + dx + w <= frame_width &&
+            y + dy >= 0 && y + dy + h <= frame_height) {
+            streams.payload[streams.payload_len++] = (uint8_t)((dy + 8) * 16 + (dx + 8));
+            return;
+        }
+    }
+    streams.payload[streams.payload_len++] = 8 * 16 + 8;  // dx = dy = 0
+}
+
+static uint16_t random_color(void) {
+    return rng_next() & 0x7FFF;
+}
+
+static uint16_t random_delta(void) {
+    // Small signed per-channel nudges, like the converter produces
+    return (uint16_t)((int16_t)((rng_next() & 0x3F) - 0x20));
+}
+
+static void encode_block(int x, int y, int w, int h) {
+    // 1x2 and 2x1 are leaves with their own opcode map
+    if (w * h == 2) {
+        if (rng_percent(static_percent)) {
+            put_2bits(0);
+            return;
+        }
+        switch (rng_next() % 4) {
+        case 0:
+            put_2bits(1);
+            put_code(x, y, w, h);
+            break;
+        case 1:
+            put_2bits(2);
+            put_code(x, y, w, h);
+            put_color(random_delta());
+            break;
+        case 2:
+            put_2bits(3);
+            put_bit(0);
+            put_color(random_color());
+            break;
+        default:
+            put_2bits(3);
+            put_bit(1);
+            put_color(random_color());
+            put_color(random_color());
+            break;
+        }
+        return;
+    }
+
+    if (rng_percent(static_percent)) {
+        put_2bits(0);
+        return;
+    }
+
+    if (rng_percent(split_percent)) {
+        put_2bits(2);
+        // 1xN only splits vertically, Nx1 only horizontally (no selector bit)
+        int vertical;
+        if (w == 1) {
+            vertical = 1;
+        } else if (h == 1) {
+            vertical = 0;
+        } else {
+            vertical = rng_next() & 1;
+            put_bit(!vertical);
+        }
+        if (vertical) {
+            encode_block(x, y, w, h / 2);
+            encode_block(x, y + h / 2, w, h / 2);
+        } else {
+            encode_block(x, y, w / 2, h);
+            encode_block(x + w / 2, y, w / 2, h);
+        }
+        return;
+    }
+
+    switch (rng_next() % 3) {
+    case 0:
+        put_2bits(1);
+        put_code(x, y, w, h);
+        break;
+    case 1:
+        put_2bits(3);
+        put_bit(0);
+        put_code(x, y, w, h);
+        put_color(random_delta());
+        break;
+    default:
+        put_2bits(3);
+        put_bit(1);
+        put_color(random_color());
+        break;
+    }
+}
+
+static void put_u16(FILE* out, uint16_t v) {
+    fputc(v & 0xFF, out);
+    fputc(v >> 8, out);
+}
+
+static uint16_t xor_key_for(int version) {
+    if (version == 0x05) return 0xD6AC;
+    if (version == 0x04) return 0x0000;
+    return 0xD669;
+}
+
+static void print_usage(const char* prog) {
+    fprintf(stderr, "Usage: %s [-n frames] [-s static%%] [-d split%%] [-v version] [-r seed] [-w width] [-h height] output.gbm\n", prog);
+}
+
+int main(int argc, char** argv) {
+    int frames = 600;
+    int version = 0x06;
+    const char* output_path = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (argv[i][0] == '-' && i + 1 < argc) {
+            int value = atoi(argv[i + 1]);
+            switch (argv[i][1]) {
+            case 'n': frames = value; break;
+            case 's': static_percent = value; break;
+            case 'd': split_percent = value; break;
+            case 'v': version = value; break;
+            case 'r': rng_state = value ? (uint32_t)value : 1; break;
+            case 'w': frame_width = value; break;
+            case 'h': frame_height = value; break;
+            default:
+                print_usage(argv[0]);
+                return 1;
+            }
+            i++;
+        } else {
+            output_path = argv[i];
+        }
+    }
+
+    if (!output_path || frames <= 0 ||
+        frame_width <= 0 || frame_height <= 0 || (frame_width & 7) || (frame_height & 7)) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    FILE* out = fopen(output_path, "wb");
+    if (!out) {
+        fprintf(stderr, "Error: Cannot create output file: %s\n", output_path);
+        return 1;
+    }
+
+    uint8_t header[GBM_HEADER_SIZE] = {0};
+    memcpy(header, "GBAM", 4);
+    header[0x10] = (uint8_t)version;
+    if (frame_width != 240 || frame_height != 160) {
+        uint8_t* tag = header + GBM_SIZE_TAG_OFFSET;
+        memcpy(tag, "SIZE", 4);
+        tag[4] = frame_width & 0xFF;
+        tag[5] = frame_width >> 8;
+        tag[6] = frame_height & 0xFF;
+        tag[7] = frame_height >> 8;
+    }
+    fwrite(header, 1, sizeof(header), out);
+
+    uint16_t xor_key = xor_key_for(version);
+
+    for (int f = 0; f < frames; f++) {
+        memset(&streams, 0, sizeof(streams));
+        streams.bit_pos = -1;
+
+        // The first frame is an intra frame: nothing to copy from yet
+        int saved_static = static_percent;
+        if (f == 0) static_percent = 0;
+
+        for (int by = 0; by < frame_height / 8; by++) {
+            for (int bx = 0; bx < frame_width / 8; bx++) {
+                encode_block(bx * 8, by * 8, 8, 8);
+            }
+        }
+        static_percent = saved_static;
+
+        uint32_t flag_bytes = streams.word_count * 4;
+        uint32_t frame_len = 4 + flag_bytes + streams.palette_len + streams.payload_len;
+        if (frame_len >= 0xFFFF) {
+            fprintf(stderr, "Error: frame %d too large (%u bytes)\n", f, frame_len);
+            fclose(out);
+            return 1;
+        }
+
+        put_u16(out, (uint16_t)frame_len);
+        put_u16(out, (uint16_t)(flag_bytes ^ xor_key));
+        put_u16(out, (uint16_t)streams.palette_len);
+        for (uint32_t i = 0; i < streams.word_count; i++) {
+            uint32_t w = streams.words[i];
+            fputc(w & 0xFF, out);
+            fputc((w >> 8) & 0xFF, out);
+            fputc((w >> 16) & 0xFF, out);
+            fputc(w >> 24, out);
+        }
+        fwrite(streams.palette, 1, streams.palette_len, out);
+        fwrite(streams.payload, 1, streams.payload_len, out);
+    }
+
+    fclose(out);
+    printf("Created: %s (%d frames, %dx%d)\n", output_path, frames, frame_width, frame_height);
+    return 0;
+}
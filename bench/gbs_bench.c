@@ -0,0 +1,314 @@
+/*
+ * GBS Bench - Host-native throughput benchmark for the GBS audio decoders
+ *
+ * Includes source/gbs_audio.c (GBS_HOST_BUILD) so its buffer decoders can
+ * be driven directly, without the timer/DMA path, and times how fast each
+ * mode decodes. Input is synthesized per mode by encoding a test signal -
+ * tones plus full-scale bursts that drive the predictor into saturation -
+ * with the decoder's own tables. A .gbs file can be given instead.
+ * The PCM modes are timed through their staging copy (decode_buffer), the
+ * path playback falls back to when a buffer cannot be played from ROM.
+ *
+ * gbs_bench_ref is the same program built with GBS_BYTE_TABLES=0:
+ * comparing the two shows the byte-table speedup, and the checksums must
+ * match.
+ *
+ * Usage:
+ *   gbs_bench [-p passes] [-s seconds] [input.gbs]
+ *     -p passes   decode each stream this many times (default 5)
+ *     -s seconds  length of the synthetic streams (default 60)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <math.h>
+
+#include "../source/gbs_audio.c"
+#include "gbs_fixture.h"
+
+static const char* const mode_names[GBS_MODE_COUNT] = {
+    "stereo 4-bit", "mono 3-bit", "mono 4-bit", "mono 2-bit", "mono 2-bit small",
+    "mono PCM", "stereo PCM"
+};
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// FNV-1a, continued across buffers
+static uint32_t checksum_update(uint32_t hash, const int8_t* samples, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        hash ^= (uint8_t)samples[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// Test signal: two tones, with a full-scale square burst every few seconds
+static int signal_at(uint32_t n, uint32_t rate, int channel) {
+    double t = (double)n / rate;
+    double v = 14000.0 * sin(2.0 * M_PI * (channel ? 330.0 : 440.0) * t) +
+               9000.0 * sin(2.0 * M_PI * 1250.0 * t + channel);
+    if (fmod(t, 3.0) < 0.25) {
+        v = fmod(t * 60.0, 1.0) < 0.5 ? 32767.0 : -32768.0;
+    }
+    return (int)v;
+}
+
+// Standard IMA ADPCM step table (89 entries). The decoder needs only its
+// diffs (ima_diff_table); the encoder compares against the step itself.
+static const int16_t ima_step_table[89] = {
+    7, 8, 9, 10, 11, 12, 13, 14, 16, 17,
+    19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+    50, 55, 60, 66, 73, 80, 88, 97, 107, 118,
+    130, 143, 157, 173, 190, 209, 230, 253, 279, 307,
+    337, 371, 408, 449, 494, 544, 598, 658, 724, 796,
+    876, 963, 1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066,
+    2272, 2499, 2749, 3024, 3327, 3660, 4026, 4428, 4871, 5358,
+    5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487, 12635, 13899,
+    15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767
+};
+
+// IMA ADPCM encoder tracking the decoder's state
+typedef struct {
+    int predictor;
+    int step_index;
+} ImaEncoder;
+
+static int ima_encode(ImaEncoder* enc, int sample) {
+    int step = ima_step_table[enc->step_index];
+    int delta = sample - enc->predictor;
+    int nibble = 0;
+    if (delta < 0) {
+        nibble = 8;
+        delta = -delta;
+    }
+    if (delta >= step) { nibble |= 4; delta -= step; }
+    if (delta >= step >> 1) { nibble |= 2; delta -= step >> 1; }
+    if (delta >= step >> 2) { nibble |= 1; }
+
+    enc->predictor += ima_diff_table[(enc->step_index << 4) + nibble];
+    if (enc->predictor > 32767) enc->predictor = 32767;
+    else if (enc->predictor < -32768) enc->predictor = -32768;
+    enc->step_index += ima_index_table[nibble];
+    if (enc->step_index < 0) enc->step_index = 0;
+    else if (enc->step_index > 88) enc->step_index = 88;
+    return nibble;
+}
+
+// 2/3-bit ADPCM encoder: try every code, keep the closest decoded result.
+// Predictor is unsigned 16-bit, centered at 0x8000.
+static int trial_encode(ChannelState* ch, int sample, int codes,
+                        int16_t (*decode)(uint8_t, ChannelState*)) {
+    int best = 0;
+    int best_error = INT32_MAX;
+    for (int code = 0; code < codes; code++) {
+        ChannelState trial = *ch;
+        int error = abs(decode((uint8_t)code, &trial) - sample);
+        if (error < best_error) {
+            best_error = error;
+            best = code;
+        }
+    }
+    decode((uint8_t)best, ch);
+    return best;
+}
+
+static void put_block_state(uint8_t* p, const ImaEncoder* enc) {
+    uint16_t predictor = (uint16_t)(enc->predictor + 0x8000);
+    p[0] = predictor & 0xFF;
+    p[1] = predictor >> 8;
+    p[2] = (uint8_t)enc->step_index;
+    p[3] = 0;
+}
+
+// PCM at 22050 Hz: the signal's top 8 bits, left plane then right plane
+static uint8_t* make_pcm_gbs(int mode, uint32_t seconds, uint32_t* size) {
+    uint32_t rate = 22050;
+    uint32_t channels = mode == GBS_MODE_PCM8_STEREO ? 2 : 1;
+    uint32_t samples = rate * seconds;
+
+    uint8_t* gbs = alloc_gbs(mode, samples * channels, rate, size);
+    if (!gbs) return NULL;
+
+    for (uint32_t c = 0; c < channels; c++) {
+        int8_t* plane = (int8_t*)gbs + GBS_HEADER_SIZE + c * samples;
+        for (uint32_t n = 0; n < samples; n++) {
+            plane[n] = (int8_t)(signal_at(n, rate, c) >> 8);
+        }
+    }
+    return gbs;
+}
+
+// Build a GBS of roughly `seconds` of audio in the given mode
+static uint8_t* make_gbs(int mode, uint32_t seconds, uint32_t* size) {
+    if (mode >= GBS_MODE_PCM8_MONO) {
+        return make_pcm_gbs(mode, seconds, size);
+    }
+
+    static const uint32_t rates[5] = { 22050, 44100, 22050, 22050, 11025 };
+    static const uint32_t block_sizes[5] = { 0x400, 0x400, 0x200, 0x200, 0x100 };
+    static const uint32_t header_sizes[5] = { 8, 4, 4, 4, 4 };
+    // Samples per data byte, x8 (3-bit packs 8 samples in 3 bytes)
+    static const uint32_t samples_x8[5] = { 8, 21, 16, 32, 32 };
+
+    uint32_t block_size = block_sizes[mode];
+    uint32_t data_per_block = block_size - header_sizes[mode];
+    uint32_t samples_per_block = data_per_block * samples_x8[mode] / 8;
+    uint32_t blocks = (rates[mode] * seconds + samples_per_block - 1) / samples_per_block;
+
+    uint8_t* gbs = alloc_gbs(mode, blocks * block_size, 0, size);
+    if (!gbs) return NULL;
+
+    ImaEncoder left = { 0, 0 };
+    ImaEncoder right = { 0, 0 };
+    ChannelState low_bit = { 0x8000, 0 };
+    uint32_t n = 0;
+
+    for (uint32_t b = 0; b < blocks; b++) {
+        uint8_t* block = gbs + GBS_HEADER_SIZE + b * block_size;
+        uint8_t* data = block + header_sizes[mode];
+
+        if (mode == GBS_MODE_STEREO_4BIT) {
+            put_block_state(block, &left);
+            put_block_state(block + 4, &right);
+            for (uint32_t i = 0; i < data_per_block; i++, n++) {
+                int lo = ima_encode(&left, signal_at(n, rates[mode], 0));
+                int hi = ima_encode(&right, signal_at(n, rates[mode], 1));
+                data[i] = (uint8_t)(lo | (hi << 4));
+            }
+        } else if (mode == GBS_MODE_MONO_4BIT) {
+            put_block_state(block, &left);
+            for (uint32_t i = 0; i < data_per_block; i++, n += 2) {
+                int lo = ima_encode(&left, signal_at(n, rates[mode], 0));
+                int hi = ima_encode(&left, signal_at(n + 1, rates[mode], 0));
+                data[i] = (uint8_t)(lo | (hi << 4));
+            }
+        } else {
+            block[0] = low_bit.predictor & 0xFF;
+            block[1] = low_bit.predictor >> 8;
+            block[2] = low_bit.step_index & 0xFF;
+            block[3] = low_bit.step_index >> 8;
+            if (mode == GBS_MODE_MONO_3BIT) {
+                // 8 codes per 3 bytes, sample 0 in the low bits, big-endian
+                for (uint32_t i = 0; i + 3 <= data_per_block; i += 3) {
+                    uint32_t packed = 0;
+                    for (int k = 0; k < 8; k++, n++) {
+                        int code = trial_encode(&low_bit, signal_at(n, rates[mode], 0), 8,
+                                                decode_adpcm_3bit);
+                        packed |= (uint32_t)code << (3 * k);
+                    }
+                    data[i] = packed >> 16;
+                    data[i + 1] = (packed >> 8) & 0xFF;
+                    data[i + 2] = packed & 0xFF;
+                }
+            } else {
+                // 4 codes per byte, sample 0 in the low bits
+                for (uint32_t i = 0; i < data_per_block; i++) {
+                    uint32_t byte = 0;
+                    for (int k = 0; k < 4; k++, n++) {
+                        int code = trial_encode(&low_bit, signal_at(n, rates[mode], 0), 4,
+                                                decode_adpcm_2bit);
+                        byte |= (uint32_t)code << (2 * k);
+                    }
+                    data[i] = (uint8_t)byte;
+                }
+            }
+        }
+    }
+    return gbs;
+}
+
+// Decode the whole stream `passes` times; returns 0 on success
+static int bench(const uint8_t* gbs, uint32_t size, int passes) {
+    static int8_t left[AUDIO_BUFFER_SAMPLES];
+    static int8_t right[AUDIO_BUFFER_SAMPLES];
+
+    uint32_t checksum = 2166136261u;
+    uint64_t samples = 0;
+    uint64_t total_ns = 0;
+    uint64_t best_ns = UINT64_MAX;
+
+    for (int pass = 0; pass < passes; pass++) {
+        if (!gbs_audio_init(gbs, size)) {
+            fprintf(stderr, "Error: not a GBS stream\n");
+            return 1;
+        }
+
+        uint64_t pass_ns = 0;
+        while (!state.info.is_finished) {
+            uint64_t start = now_ns();
+            decode_buffer(left, state.info.channels == 2 ? right : NULL, AUDIO_BUFFER_SAMPLES);
+            pass_ns += now_ns() - start;
+
+            if (pass == 0) {
+                checksum = checksum_update(checksum, left, AUDIO_BUFFER_SAMPLES);
+                if (state.info.channels == 2) {
+                    checksum = checksum_update(checksum, right, AUDIO_BUFFER_SAMPLES);
+                }
+            }
+        }
+        samples += state.info.samples_decoded;
+        total_ns += pass_ns;
+        if (pass_ns < best_ns) best_ns = pass_ns;
+    }
+
+    int mode = state.info.mode;
+    uint64_t per_pass = samples / passes;
+    printf("Mode %d %-17s %9.2f Msamples/s (best %.2f), %llu samples, checksum %08x\n",
+           mode, mode_names[mode],
+           total_ns ? (double)samples * 1000.0 / total_ns : 0.0,
+           best_ns ? (double)per_pass * 1000.0 / best_ns : 0.0,
+           (unsigned long long)per_pass, checksum);
+
+    gbs_audio_shutdown();
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    const char* input_path = NULL;
+    int passes = 5;
+    uint32_t seconds = 60;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-p") == 0 && i + 1 < argc) {
+            passes = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+            seconds = (uint32_t)atoi(argv[++i]);
+        } else {
+            input_path = argv[i];
+        }
+    }
+
+    if (passes <= 0 || seconds == 0) {
+        fprintf(stderr, "Usage: %s [-p passes] [-s seconds] [input.gbs]\n", argv[0]);
+        return 1;
+    }
+
+    printf("Byte tables: %s\n", GBS_BYTE_TABLES ? "on" : "off");
+
+    if (input_path) {
+        uint32_t size = 0;
+        uint8_t* gbs = load_file(input_path, &size);
+        if (!gbs) {
+            fprintf(stderr, "Error: Cannot read %s\n", input_path);
+            return 1;
+        }
+        int result = bench(gbs, size, passes);
+        free(gbs);
+        return result;
+    }
+
+    int failed = 0;
+    for (int mode = 0; mode < GBS_MODE_COUNT; mode++) {
+        uint32_t size = 0;
+        uint8_t* gbs = make_gbs(mode, seconds, &size);
+        if (!gbs) return 1;
+        failed |= bench(gbs, size, passes);
+        free(gbs);
+    }
+    return failed;
+}
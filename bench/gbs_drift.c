@@ -0,0 +1,152 @@
+/*
+ * GBS Drift - Simulate long audio playback and measure sample-clock drift
+ *
+ * Builds source/gbs_audio.c natively (GBS_HOST_BUILD) against the register
+ * shims in shim/ and plays a silent synthetic .gbs for a simulated run.
+ * Timer0 is emulated from the reload values the audio code programs: each
+ * overflow latches the current reload, so a reload written in the Timer1
+ * IRQ takes effect one sample into the next buffer, as on hardware.
+ *
+ * Drift is the simulated playback time minus the nominal time of the
+ * samples played (sample count / sample rate), reported for the real
+ * timer programming and for a fixed GBA_MASTER_CLOCK / rate reload.
+ * Playback loops; at every buffer boundary gbs_audio_get_position() and
+ * gbs_audio_get_loop_count() must agree with the samples played.
+ *
+ * Built with GBS_AUDIO_STATS: the main loop keeps the ring full, so any
+ * underrun, IRQ decode or silence in the telemetry is a failure too.
+ *
+ * Usage:
+ *   gbs_drift [-m mode] [-t hours] [-l limit_ms] [-b buffer_ms] [-s stats.sav]
+ *     -m mode      GBS mode 0-6, or -1 for all (default -1)
+ *     -t hours     simulated run length (default 2)
+ *     -l limit_ms  fail if |drift| ever exceeds this (default 1)
+ *     -b buffer_ms audio buffer latency (gbs_audio_set_buffer_ms, default 0)
+ *     -s stats.sav write the SRAM after gbs_audio_save_stats() (see gbs_stats)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+
+#include "gbs_audio.h"
+#include "gba_interrupt.h"
+#include "gbs_fixture.h"
+
+#define GBA_MASTER_CLOCK    16777216.0
+
+// Silent audio per pass; playback loops, as in main.c
+#define GBS_DATA_BYTES      (4 * 1024 * 1024)
+
+// Returns 0 if drift stayed within limit_ms
+static int simulate(int mode, double hours, double limit_ms) {
+    uint32_t size;
+    uint8_t* gbs = alloc_gbs(mode, GBS_DATA_BYTES, 22050, &size);
+    if (!gbs || !gbs_audio_init(gbs, size)) {
+        fprintf(stderr, "Error: cannot set up mode %d\n", mode);
+        free(gbs);
+        return 1;
+    }
+
+    gbs_audio_set_loop(true);
+    gbs_audio_reset_stats();
+
+    const GbsAudioInfo* info = gbs_audio_get_info();
+    double rate = info->sample_rate;
+    double fixed_period = floor(GBA_MASTER_CLOCK / rate);
+
+    gbs_audio_start();
+    uint32_t buffer_samples = 65536 - REG_TM1CNT_L;
+    uint32_t latched = 65536 - REG_TM0CNT_L;   // Period of the next sample
+
+    double end_cycles = hours * 3600.0 * GBA_MASTER_CLOCK;
+    double cycles = 0.0;
+    double samples = 0.0;
+    double max_drift_ms = 0.0;
+    uint64_t played = 0;
+    uint32_t clock_errors = 0;
+
+    while (cycles < end_cycles) {
+        // One buffer: the first sample runs at the latched period, the rest
+        // at the reload programmed for this buffer
+        uint32_t period = 65536 - REG_TM0CNT_L;
+        cycles += latched + (double)(buffer_samples - 1) * period;
+        latched = period;
+        samples += buffer_samples;
+
+        double drift_ms = (cycles / GBA_MASTER_CLOCK - samples / rate) * 1000.0;
+        if (fabs(drift_ms) > max_drift_ms) max_drift_ms = fabs(drift_ms);
+
+        // Main loop: top up the ring, then the buffer ends
+        gbs_audio_update();
+        host_irq_raise(IRQ_TIMER1);
+
+        // The next buffer is on air from its first sample
+        played += buffer_samples;
+        if (gbs_audio_get_position() != played % info->total_samples ||
+            gbs_audio_get_loop_count() != played / info->total_samples) {
+            clock_errors++;
+        }
+    }
+
+    double drift_ms = (cycles / GBA_MASTER_CLOCK - samples / rate) * 1000.0;
+    double fixed_ms = (samples * fixed_period / GBA_MASTER_CLOCK - samples / rate) * 1000.0;
+    GbsAudioStats stats;
+    gbs_audio_get_stats(&stats);
+    uint32_t glitches = stats.underruns + stats.irq_decodes + stats.silence_samples;
+    int failed = max_drift_ms > limit_ms || clock_errors > 0 || glitches > 0;
+
+    printf("Mode %d (%5.0f Hz, %u-sample buffers, %u loops) over %.1f h:\n",
+           mode, rate, buffer_samples, gbs_audio_get_loop_count(), hours);
+    printf("  drift %+9.3f ms (max |%.3f| ms), fixed reload %+9.1f ms, %u clock errors, %u glitches  %s\n",
+           drift_ms, max_drift_ms, fixed_ms, clock_errors, glitches, failed ? "FAIL" : "ok");
+
+    gbs_audio_shutdown();
+    free(gbs);
+    return failed;
+}
+
+int main(int argc, char** argv) {
+    int mode = -1;
+    double hours = 2.0;
+    double limit_ms = 1.0;
+    const char* stats_path = NULL;
+
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (strcmp(argv[i], "-m") == 0) {
+            mode = atoi(argv[i + 1]);
+        } else if (strcmp(argv[i], "-t") == 0) {
+            hours = atof(argv[i + 1]);
+        } else if (strcmp(argv[i], "-l") == 0) {
+            limit_ms = atof(argv[i + 1]);
+        } else if (strcmp(argv[i], "-b") == 0) {
+            gbs_audio_set_buffer_ms((uint32_t)atoi(argv[i + 1]));
+        } else if (strcmp(argv[i], "-s") == 0) {
+            stats_path = argv[i + 1];
+        } else {
+            fprintf(stderr, "Usage: %s [-m mode] [-t hours] [-l limit_ms] [-b buffer_ms] [-s stats.sav]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    int failed = 0;
+    for (int m = 0; m < GBS_MODE_COUNT; m++) {
+        if (mode < 0 || mode == m) {
+            failed |= simulate(m, hours, limit_ms);
+        }
+    }
+
+    // The last mode's telemetry, as a cart would leave it in SRAM
+    if (stats_path) {
+        FILE* f = fopen(stats_path, "wb");
+        if (!f || !gbs_audio_save_stats() ||
+            fwrite(host_sram, 1, sizeof(host_sram), f) != sizeof(host_sram)) {
+            fprintf(stderr, "Error: Cannot write %s\n", stats_path);
+            failed = 1;
+        }
+        if (f) fclose(f);
+    }
+    return failed;
+}
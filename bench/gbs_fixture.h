@@ -0,0 +1,93 @@
+/*
+ * GBS Fixture - Test streams shared by the host audio tools
+ *
+ * Header only: the tools are single files, and most of them include
+ * source/gbs_audio.c itself. Include after gbs_audio.h (or gbs_audio.c).
+ *
+ * Every stream starts with the header gbs_audio_init() reads: "GBAL", the
+ * file size at bytes 4-7, "MUSI", the PCM rate at 12-13, the mode at 16.
+ */
+
+#ifndef GBS_FIXTURE_H
+#define GBS_FIXTURE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "gbs_audio.h"
+
+// Same sequence in every tool, so a failing run can be replayed
+static uint32_t rng_state = 0x2545F491u;
+
+static inline uint32_t rng(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state;
+}
+
+static inline uint8_t* load_file(const char* path, uint32_t* size) {
+    FILE* f = fopen(path, "rb");
+    if (!f) return NULL;
+
+    fseek(f, 0, SEEK_END);
+    long len = ftell(f);
+    fseek(f, 0, SEEK_SET);
+
+    uint8_t* data = malloc(len > 0 ? len : 1);
+    if (data && fread(data, 1, len, f) != (size_t)len) {
+        free(data);
+        data = NULL;
+    }
+    fclose(f);
+
+    *size = (uint32_t)len;
+    return data;
+}
+
+static inline void put_gbs_header(uint8_t* gbs, uint32_t size, int mode, uint32_t rate) {
+    memcpy(gbs, "GBAL", 4);
+    gbs[4] = size & 0xFF;
+    gbs[5] = (size >> 8) & 0xFF;
+    gbs[6] = (size >> 16) & 0xFF;
+    gbs[7] = size >> 24;
+    memcpy(gbs + 8, "MUSI", 4);
+    gbs[12] = rate & 0xFF;
+    gbs[13] = rate >> 8;
+    gbs[16] = (uint8_t)mode;
+}
+
+// Header plus data_size zero bytes (silence in every mode)
+static inline uint8_t* alloc_gbs(int mode, uint32_t data_size, uint32_t rate, uint32_t* size) {
+    *size = GBS_HEADER_SIZE + data_size;
+    uint8_t* gbs = calloc(1, *size);
+    if (gbs) put_gbs_header(gbs, *size, mode, rate);
+    return gbs;
+}
+
+// Random data at 22050 Hz (PCM; the M3 modes ignore the rate). Block headers
+// use the full predictor range and the mode's step range: IMA indexes 0-88,
+// 2-bit steps 0-0x160.
+static inline uint8_t* make_random_gbs(int mode, uint32_t blocks, uint32_t block_size,
+                                       uint32_t block_header_size, uint32_t* size) {
+    uint32_t max_step = (mode == GBS_MODE_MONO_2BIT || mode == GBS_MODE_MONO_2BIT_SM) ? 0x160 : 88;
+    uint8_t* gbs = alloc_gbs(mode, blocks * block_size, 22050, size);
+    if (!gbs) return NULL;
+
+    for (uint32_t b = 0; b < blocks; b++) {
+        uint8_t* block = gbs + GBS_HEADER_SIZE + b * block_size;
+        for (uint32_t i = 0; i < block_size; i++) {
+            block[i] = (uint8_t)rng();
+        }
+        for (uint32_t h = 0; h < block_header_size; h += 4) {
+            uint32_t step = rng() % (max_step + 1);
+            block[h + 2] = step & 0xFF;
+            block[h + 3] = step >> 8;
+        }
+    }
+    return gbs;
+}
+
+#endif // GBS_FIXTURE_H
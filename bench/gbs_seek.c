@@ -0,0 +1,261 @@
+/*
+ * GBS Seek - Check that sample-accurate seeks land on the exact sample
+ *
+ * Includes source/gbs_audio.c (GBS_HOST_BUILD) against the register shims.
+ * For each mode a stream of random block headers and data is decoded end to
+ * end once as the reference; then each seek target - block and byte/group
+ * boundaries either side, the last sample, random points - is checked:
+ * gbs_audio_get_position() must equal the target and the buffer on air
+ * must match the reference from that sample on.
+ * gbs_audio_seek_ms() is checked against the rounded-down sample.
+ *
+ * Seeks are made while stopped and while playing. A seek while playing must
+ * leave the buffer on air alone and take effect at the next Timer1 IRQ,
+ * followed by continuous audio; with looping on, playback near the end must
+ * run on into the start of the stream without a gap. Until that IRQ the
+ * position must read the target, also part way through the old buffer - a
+ * backward seek must not read as the old position and pull A/V sync back.
+ *
+ * Usage:
+ *   gbs_seek [-n seeks] [-b blocks] [-l ms]
+ *     -n seeks    random targets per mode (default 2000)
+ *     -b blocks   blocks per stream (default 40)
+ *     -l ms       audio buffer latency (gbs_audio_set_buffer_ms, default 0)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../source/gbs_audio.c"
+#include "gbs_fixture.h"
+
+// PCM samples are 1-sample blocks: give them 1021 per block asked for, so
+// word-aligned and unaligned positions both come up.
+static uint8_t* make_gbs(int mode, uint32_t blocks, uint32_t* size) {
+    const GbsModeOps* ops = &gbs_modes[mode];
+    if (ops->samples_per_block == 1) blocks *= 1021;
+    return make_random_gbs(mode, blocks, ops->block_size, ops->block_header_size, size);
+}
+
+// Whole stream decoded from the start, buffer by buffer
+static int8_t* decode_reference(int channels, uint32_t total, int8_t** right_out) {
+    uint32_t buffers = (total + AUDIO_BUFFER_SAMPLES - 1) / AUDIO_BUFFER_SAMPLES;
+    int8_t* left = calloc(buffers, AUDIO_BUFFER_SAMPLES);
+    int8_t* right = calloc(buffers, AUDIO_BUFFER_SAMPLES);
+
+    for (uint32_t i = 0; i < buffers; i++) {
+        decode_buffer(left + i * AUDIO_BUFFER_SAMPLES,
+                      channels == 2 ? right + i * AUDIO_BUFFER_SAMPLES : NULL,
+                      AUDIO_BUFFER_SAMPLES);
+    }
+    *right_out = right;
+    return left;
+}
+
+// Compare the buffer on air with the reference from expected on
+static int check_target(uint64_t target, uint32_t expected, const int8_t* ref_left,
+                        const int8_t* ref_right, const char* how) {
+    uint32_t total = state.info.total_samples;
+    uint32_t position = gbs_audio_get_position();
+    if (position != expected) {
+        printf("  %s %llu: position %u, expected %u\n", how,
+               (unsigned long long)target, position, expected);
+        return 1;
+    }
+
+    const int8_t* left = state.slot_left[state.play_buffer];
+    const int8_t* right = state.slot_right[state.play_buffer];
+    for (uint32_t i = 0; i < state.info.buffer_samples; i++) {
+        uint32_t n = expected + i;
+        if (state.loop && n >= total) n -= total;
+        int8_t want_left = n < total ? ref_left[n] : 0;
+        int8_t want_right = n < total ? ref_right[n] : 0;
+        if (left[i] != want_left ||
+            (state.info.channels == 2 && right[i] != want_right)) {
+            printf("  %s %llu: sample %u differs from the reference\n", how,
+                   (unsigned long long)target, n);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Next buffer boundary, with the main loop topping up the ring first
+static void play_buffer_out(void) {
+    gbs_audio_update();
+    host_irq_raise(IRQ_TIMER1);
+}
+
+// Position with TM1 `played` samples into the buffer on air
+static uint32_t position_at(uint32_t played) {
+    uint16_t count = REG_TM1CNT_L;
+    REG_TM1CNT_L = (uint16_t)(65536 - state.info.buffer_samples + played);
+    uint32_t position = gbs_audio_get_position();
+    REG_TM1CNT_L = count;
+    return position;
+}
+
+// Seek while playing: the buffer on air plays out, then the target follows
+static int check_live_seek(uint32_t target, const int8_t* ref_left, const int8_t* ref_right) {
+    uint32_t total = state.info.total_samples;
+    uint8_t slot = state.play_buffer;
+
+    gbs_audio_seek_sample(target);
+    if (state.play_buffer != slot) {
+        printf("  live %u: the buffer on air changed\n", target);
+        return 1;
+    }
+
+    // Not heard yet: the clock holds at the target for the rest of the
+    // old buffer
+    uint32_t half = position_at(state.info.buffer_samples / 2);
+    uint32_t now = gbs_audio_get_position();
+    if (now != target || half != target) {
+        printf("  live %u: position %u (%u mid-buffer) before the seek is heard\n",
+               target, now, half);
+        return 1;
+    }
+
+    // Target at the boundary, then continuous audio
+    uint32_t expected = target;
+    for (int i = 0; i < 3; i++) {
+        play_buffer_out();
+        if (check_target(target, expected, ref_left, ref_right, "live")) return 1;
+        expected += state.info.buffer_samples;
+        if (expected >= total) {
+            if (!state.loop) break;
+            expected -= total;
+        }
+    }
+    return 0;
+}
+
+// Returns the number of failed seeks
+static int check_mode(int mode, uint32_t blocks, int seeks) {
+    uint32_t size;
+    uint8_t* gbs = make_gbs(mode, blocks, &size);
+    if (!gbs || !gbs_audio_init(gbs, size)) {
+        fprintf(stderr, "Error: cannot set up mode %d\n", mode);
+        free(gbs);
+        return 1;
+    }
+
+    uint32_t total = state.info.total_samples;
+    uint32_t per_block = state.ops.samples_per_block;
+    int8_t* ref_right;
+    int8_t* ref_left = decode_reference(state.info.channels, total, &ref_right);
+
+    int failed = 0;
+    int checked = 0;
+
+    // Stopped seeks (gbs_audio_start at the target): block boundaries and
+    // the samples around them, then random targets
+    for (uint32_t b = 0; b < blocks; b++) {
+        for (int d = -9; d <= 9; d++) {
+            int64_t target = (int64_t)b * per_block + d;
+            if (target < 0 || target >= total) continue;
+            gbs_audio_stop();
+            gbs_audio_seek_sample((uint64_t)target);
+            failed += check_target((uint64_t)target, (uint32_t)target, ref_left, ref_right, "sample");
+            checked++;
+        }
+    }
+    for (int i = 0; i < seeks; i++) {
+        uint32_t target = rng() % total;
+        gbs_audio_stop();
+        gbs_audio_seek_sample(target);
+        failed += check_target(target, target, ref_left, ref_right, "sample");
+        checked++;
+    }
+
+    // Last sample, and past the end (wraps to the beginning)
+    gbs_audio_stop();
+    gbs_audio_seek_sample(total - 1);
+    failed += check_target(total - 1, total - 1, ref_left, ref_right, "sample");
+    gbs_audio_stop();
+    gbs_audio_seek_sample((uint64_t)total + 5);
+    failed += check_target((uint64_t)total + 5, 0, ref_left, ref_right, "sample");
+    checked += 2;
+
+    uint32_t total_ms = (uint32_t)((uint64_t)total * 1000 / state.info.sample_rate);
+    for (int i = 0; i < seeks / 4; i++) {
+        uint32_t ms = rng() % total_ms;
+        gbs_audio_stop();
+        gbs_audio_seek_ms(ms);
+        uint32_t expected = (uint32_t)((uint64_t)ms * state.info.sample_rate / 1000);
+        failed += check_target(ms, expected, ref_left, ref_right, "ms");
+        checked++;
+    }
+
+    // Live seeks from a running player, looping off then on; loop targets
+    // sit near the end so the ring wraps into the start of the stream
+    gbs_audio_seek_sample(0);
+    for (int i = 0; i < seeks / 4; i++) {
+        failed += check_live_seek(rng() % total, ref_left, ref_right);
+        checked++;
+        if (!gbs_audio_is_playing()) gbs_audio_restart();
+    }
+
+    // Backward live seeks after playing on a while
+    gbs_audio_seek_sample(0);
+    for (int i = 0; i < seeks / 4; i++) {
+        uint32_t ahead = 1 + rng() % 4;
+        while (ahead-- > 0 && gbs_audio_is_playing()) play_buffer_out();
+        if (!gbs_audio_is_playing()) gbs_audio_restart();
+
+        uint32_t position = position_at(rng() % state.info.buffer_samples);
+        failed += check_live_seek(position ? rng() % position : 0, ref_left, ref_right);
+        checked++;
+        if (!gbs_audio_is_playing()) gbs_audio_restart();
+    }
+
+    gbs_audio_set_loop(true);
+    for (int i = 0; i < seeks / 4; i++) {
+        uint32_t back = 1 + rng() % (3 * state.info.buffer_samples);
+        failed += check_live_seek(back < total ? total - back : 0, ref_left, ref_right);
+        checked++;
+    }
+    uint32_t loops = gbs_audio_get_loop_count();
+    if (loops == 0) {
+        printf("  loop: playback never wrapped\n");
+        failed++;
+    }
+
+    printf("Mode %d (%u-sample buffers): %d seeks, %d failed, %u loops\n",
+           mode, state.info.buffer_samples, checked, failed, loops);
+
+    gbs_audio_shutdown();
+    free(ref_left);
+    free(ref_right);
+    free(gbs);
+    return failed;
+}
+
+int main(int argc, char** argv) {
+    int seeks = 2000;
+    uint32_t blocks = 40;
+
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (strcmp(argv[i], "-n") == 0) {
+            seeks = atoi(argv[i + 1]);
+        } else if (strcmp(argv[i], "-b") == 0) {
+            blocks = (uint32_t)atoi(argv[i + 1]);
+        } else if (strcmp(argv[i], "-l") == 0) {
+            gbs_audio_set_buffer_ms((uint32_t)atoi(argv[i + 1]));
+        } else {
+            fprintf(stderr, "Usage: %s [-n seeks] [-b blocks] [-l ms]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    if (seeks < 0 || blocks == 0) {
+        fprintf(stderr, "Usage: %s [-n seeks] [-b blocks] [-l ms]\n", argv[0]);
+        return 1;
+    }
+
+    int failed = 0;
+    for (int mode = 0; mode < GBS_MODE_COUNT; mode++) {
+        failed += check_mode(mode, blocks, seeks);
+    }
+    return failed != 0;
+}
@@ -0,0 +1,82 @@
+/*
+ * GBS Stats - Print the audio telemetry record from a cart's SRAM dump
+ *
+ * Players built with GBS_AUDIO_STATS=1 write it with gbs_audio_save_stats()
+ * (on pause and at each loop of the movie): "GBST", the record size (u32),
+ * then the GbsAudioStats fields, little-endian.
+ *
+ * Usage:
+ *   gbs_stats [-o offset] movie.sav
+ *     -o offset   byte offset of the record (GBS_STATS_SRAM_OFFSET, default 0)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "gbs_audio.h"
+
+static const char* const mode_names[GBS_MODE_COUNT] = {
+    "stereo 4-bit", "mono 3-bit", "mono 4-bit", "mono 2-bit", "mono 2-bit small",
+    "mono PCM", "stereo PCM"
+};
+
+int main(int argc, char** argv) {
+    long offset = 0;
+    const char* path = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            offset = strtol(argv[++i], NULL, 0);
+        } else if (!path) {
+            path = argv[i];
+        } else {
+            path = NULL;
+            break;
+        }
+    }
+    if (!path || offset < 0) {
+        fprintf(stderr, "Usage: %s [-o offset] movie.sav\n", argv[0]);
+        return 1;
+    }
+
+    FILE* f = fopen(path, "rb");
+    if (!f) {
+        fprintf(stderr, "Error: Cannot open %s\n", path);
+        return 1;
+    }
+
+    uint8_t head[8];
+    GbsAudioStats stats;
+    memset(&stats, 0, sizeof(stats));
+    int ok = fseek(f, offset, SEEK_SET) == 0 && fread(head, 1, 8, f) == 8 &&
+             memcmp(head, "GBST", 4) == 0;
+    uint32_t size = head[4] | (head[5] << 8) | (head[6] << 16) | ((uint32_t)head[7] << 24);
+    // Older or newer players: read the fields both know
+    if (ok) {
+        if (size > sizeof(stats)) size = sizeof(stats);
+        ok = fread(&stats, 1, size, f) == size;
+    }
+    fclose(f);
+    if (!ok) {
+        fprintf(stderr, "Error: No audio stats record in %s\n", path);
+        return 1;
+    }
+
+    uint32_t irqs = stats.irq_count;
+    printf("Timer1 IRQs      %10u\n", irqs);
+    printf("Late swaps       %10u (%.3f%%), worst %u samples\n", stats.late_swaps,
+           irqs ? stats.late_swaps * 100.0 / irqs : 0.0, stats.max_late_samples);
+    printf("Underruns        %10u\n", stats.underruns);
+    printf("IRQ decodes      %10u\n", stats.irq_decodes);
+    printf("Silence samples  %10u\n", stats.silence_samples);
+    printf("IRQ cycles       %10u mean, %u max\n", stats.irq_cycles_mean, stats.irq_cycles_max);
+    for (int mode = 0; mode < GBS_MODE_COUNT; mode++) {
+        if (stats.blocks_decoded[mode]) {
+            printf("Mode %d %-16s %u %s\n", mode, mode_names[mode], stats.blocks_decoded[mode],
+                   mode >= GBS_MODE_PCM8_MONO ? "samples" : "blocks");
+        }
+    }
+    return 0;
+}
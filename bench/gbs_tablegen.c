@@ -0,0 +1,177 @@
+/*
+ * GBS Tablegen - Generate the byte-wide ADPCM tables for the audio decoder
+ *
+ * Writes source/gbs_byte_tables.c: for every step index and data byte, the
+ * result of decoding all the codes in the byte (low bits first) as
+ * source/gbs_audio.c does code by code, without clamping the predictor.
+ *
+ * 4-bit IMA (two codes of one channel per nibble pair, low nibble first;
+ * a mono data byte, or the same-channel nibbles of two stereo bytes):
+ *   ima_byte_diffs[step_index * 256 + pair] = diff1 | diff2 << 16
+ *   ima_byte_step[step_index * 256 + pair]  = final step_index
+ *
+ * Mono 2-bit (four codes per byte; step_index is a multiple of 4):
+ *   adpcm2_byte_deltas[(step_index / 4 * 256 + byte) * 2]     = delta1 | delta2 << 16
+ *   adpcm2_byte_deltas[(step_index / 4 * 256 + byte) * 2 + 1] = delta3 | delta4 << 16
+ *   adpcm2_byte_step[step_index / 4 * 256 + byte]             = final step_index / 4
+ *
+ * Diffs and deltas are the decoder's own table entries (ima_diff_table,
+ * adpcm2_delta_table) - the tables are taken from gbs_audio.c itself, so
+ * the two cannot disagree.
+ *
+ * Usage:
+ *   gbs_tablegen output.c
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+
+// The decoder's own tables; it needs no byte tables for that
+#define GBS_BYTE_TABLES 0
+#include "../source/gbs_audio.c"
+
+// Per-nibble step walk, exactly as decode_ima_4bit() does it
+static int ima_next_index(int step_index, int nibble) {
+    step_index += ima_index_table[nibble];
+    if (step_index < 0) return 0;
+    if (step_index > 88) return 88;
+    return step_index;
+}
+
+static void write_ima_tables(FILE* out) {
+    fprintf(out,
+        "// 4-bit IMA: index = step_index * 256 + nibble pair, first code in the low nibble\n"
+        "//   [index] = diff1 | diff2 << 16\n"
+        "// 89 * 256 * 4 bytes = 91136 bytes\n"
+        "const uint32_t ima_byte_diffs[89 * 256] = {\n");
+
+    for (int s = 0; s < 89; s++) {
+        fprintf(out, "    // step_index=%d\n", s);
+        for (int pair = 0; pair < 256; pair++) {
+            int lo = pair & 0x0F;
+            int hi = pair >> 4;
+            uint32_t diff1 = (uint16_t)ima_diff_table[(s << 4) + lo];
+            uint32_t diff2 = (uint16_t)ima_diff_table[(ima_next_index(s, lo) << 4) + hi];
+
+            if ((pair & 7) == 0) fprintf(out, "   ");
+            fprintf(out, " 0x%08X,", diff1 | diff2 << 16);
+            if ((pair & 7) == 7) fprintf(out, "\n");
+        }
+    }
+
+    fprintf(out, "};\n\n");
+
+    fprintf(out,
+        "// 4-bit IMA: step_index after both codes, same index\n"
+        "const uint8_t ima_byte_step[89 * 256] = {\n");
+
+    for (int s = 0; s < 89; s++) {
+        fprintf(out, "    // step_index=%d\n", s);
+        for (int pair = 0; pair < 256; pair++) {
+            int step_index = ima_next_index(ima_next_index(s, pair & 0x0F), pair >> 4);
+
+            if ((pair & 15) == 0) fprintf(out, "   ");
+            fprintf(out, " %d,", step_index);
+            if ((pair & 15) == 15) fprintf(out, "\n");
+        }
+    }
+
+    fprintf(out, "};\n\n");
+}
+
+// Per-code delta and step walk, exactly as decode_adpcm_2bit() does them
+static int code_delta(int step_index, int code) {
+    int table_index = code + step_index;
+    if (table_index > 352) table_index = 352;
+    return adpcm2_delta_table[table_index];
+}
+
+static int next_step(int step_index, int code) {
+    if (code & 1) {
+        step_index += 4;
+        if (step_index > 0x160) step_index = 0x160;
+    } else {
+        step_index -= 4;
+        if (step_index < 0) step_index = 0;
+    }
+    return step_index;
+}
+
+static void write_adpcm2_tables(FILE* out) {
+    fprintf(out,
+        "// Mono 2-bit: index = step_index / 4 * 256 + byte, code 0 in the low bits\n"
+        "//   [index * 2] = delta1 | delta2 << 16, [index * 2 + 1] = delta3 | delta4 << 16\n"
+        "// 89 * 256 * 8 bytes = 182272 bytes\n"
+        "const uint32_t adpcm2_byte_deltas[89 * 256 * 2] = {\n");
+
+    for (int s4 = 0; s4 < 89; s4++) {
+        fprintf(out, "    // step_index=%d\n", s4 * 4);
+        for (int byte = 0; byte < 256; byte++) {
+            int step_index = s4 * 4;
+            uint32_t delta[4];
+            for (int k = 0; k < 4; k++) {
+                int code = (byte >> (2 * k)) & 3;
+                delta[k] = (uint16_t)code_delta(step_index, code);
+                step_index = next_step(step_index, code);
+            }
+
+            if ((byte & 3) == 0) fprintf(out, "   ");
+            fprintf(out, " 0x%08X, 0x%08X,", delta[0] | delta[1] << 16, delta[2] | delta[3] << 16);
+            if ((byte & 3) == 3) fprintf(out, "\n");
+        }
+    }
+
+    fprintf(out, "};\n\n");
+
+    fprintf(out,
+        "// Mono 2-bit: step_index / 4 after the four codes, same index\n"
+        "const uint8_t adpcm2_byte_step[89 * 256] = {\n");
+
+    for (int s4 = 0; s4 < 89; s4++) {
+        fprintf(out, "    // step_index=%d\n", s4 * 4);
+        for (int byte = 0; byte < 256; byte++) {
+            int step_index = s4 * 4;
+            for (int k = 0; k < 4; k++) {
+                step_index = next_step(step_index, (byte >> (2 * k)) & 3);
+            }
+
+            if ((byte & 15) == 0) fprintf(out, "   ");
+            fprintf(out, " %d,", step_index / 4);
+            if ((byte & 15) == 15) fprintf(out, "\n");
+        }
+    }
+
+    fprintf(out, "};\n");
+}
+
+int main(int argc, char** argv) {
+    if (argc != 2) {
+        fprintf(stderr, "Usage: %s output.c\n", argv[0]);
+        return 1;
+    }
+
+    FILE* out = fopen(argv[1], "w");
+    if (!out) {
+        fprintf(stderr, "Error: Cannot create output file: %s\n", argv[1]);
+        return 1;
+    }
+
+    fprintf(out,
+        "/*\n"
+        " * Byte-wide ADPCM tables for GBS audio: all codes of a data byte per lookup\n"
+        " *\n"
+        " * Generated by bench/gbs_tablegen.c - do not edit.\n"
+        " *\n"
+        " * Predictor saturation is not applied; the decoder falls back to\n"
+        " * decoding code by code when a sample would clamp. Kept in ROM.\n"
+        " */\n"
+        "\n"
+        "#include <stdint.h>\n"
+        "\n");
+
+    write_ima_tables(out);
+    write_adpcm2_tables(out);
+
+    fclose(out);
+    return 0;
+}
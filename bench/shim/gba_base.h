@@ -0,0 +1,23 @@
+/*
+ * Host shim for <gba_base.h>
+ *
+ * Lets the audio core build natively (GBS_HOST_BUILD) for host tools.
+ */
+
+#ifndef HOST_GBA_BASE_H
+#define HOST_GBA_BASE_H
+
+#include "gba_types.h"
+
+typedef volatile uint16_t vu16;
+typedef volatile uint32_t vu32;
+
+#define IWRAM_DATA
+#define EWRAM_DATA
+#define EWRAM_BSS
+
+// Cartridge SRAM (see gba_regs_host.c)
+extern uint8_t host_sram[0x10000];
+#define SRAM    host_sram
+
+#endif // HOST_GBA_BASE_H
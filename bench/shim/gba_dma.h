@@ -0,0 +1,20 @@
+/*
+ * Host shim for <gba_dma.h>
+ */
+
+#ifndef HOST_GBA_DMA_H
+#define HOST_GBA_DMA_H
+
+#include "gba_regs_host.h"
+
+#define DMA_DST_INC     (0 << 21)
+#define DMA_DST_DEC     (1 << 21)
+#define DMA_DST_FIXED   (2 << 21)
+#define DMA_SRC_INC     (0 << 23)
+#define DMA_REPEAT      (1 << 25)
+#define DMA16           (0 << 26)
+#define DMA32           (1 << 26)
+#define DMA_SPECIAL     (3 << 28)
+#define DMA_ENABLE      (1u << 31)
+
+#endif // HOST_GBA_DMA_H
@@ -0,0 +1,39 @@
+/*
+ * Host shim for <gba_interrupt.h>
+ *
+ * irqSet() records the handler; host tools raise it with host_irq_raise().
+ */
+
+#ifndef HOST_GBA_INTERRUPT_H
+#define HOST_GBA_INTERRUPT_H
+
+#include "gba_regs_host.h"
+
+typedef enum {
+    IRQ_VBLANK  = (1 << 0),
+    IRQ_HBLANK  = (1 << 1),
+    IRQ_VCOUNT  = (1 << 2),
+    IRQ_TIMER0  = (1 << 3),
+    IRQ_TIMER1  = (1 << 4),
+    IRQ_TIMER2  = (1 << 5),
+    IRQ_TIMER3  = (1 << 6),
+    IRQ_SERIAL  = (1 << 7),
+    IRQ_DMA0    = (1 << 8),
+    IRQ_DMA1    = (1 << 9),
+    IRQ_DMA2    = (1 << 10),
+    IRQ_DMA3    = (1 << 11),
+    IRQ_KEYPAD  = (1 << 12),
+    IRQ_GAMEPAK = (1 << 13),
+} irqMASK;
+
+typedef void (*IntFn)(void);
+
+void irqSet(irqMASK mask, IntFn function);
+void irqEnable(int mask);
+void irqDisable(int mask);
+
+// Run the handler registered for mask if that IRQ is enabled; REG_IF
+// shows the IRQ pending until the handler returns (acknowledged)
+void host_irq_raise(irqMASK mask);
+
+#endif // HOST_GBA_INTERRUPT_H
@@ -0,0 +1,50 @@
+/*
+ * Host shim: register storage and IRQ dispatch for the GBA headers in shim/
+ */
+
+#include "gba_interrupt.h"
+
+vu16 REG_IME, REG_IE, REG_IF;
+
+vu16 REG_TM0CNT_L, REG_TM0CNT_H;
+vu16 REG_TM1CNT_L, REG_TM1CNT_H;
+vu16 REG_TM2CNT_L, REG_TM2CNT_H;
+vu16 REG_TM3CNT_L, REG_TM3CNT_H;
+
+vu32 REG_DMA1SAD, REG_DMA1DAD, REG_DMA1CNT;
+vu32 REG_DMA2SAD, REG_DMA2DAD, REG_DMA2CNT;
+
+vu16 REG_SOUNDCNT_L, REG_SOUNDCNT_H, REG_SOUNDCNT_X;
+vu32 REG_FIFO_A, REG_FIFO_B;
+
+uint8_t host_sram[0x10000];
+
+static IntFn handlers[14];
+
+static int irq_bit(int mask) {
+    int bit = 0;
+    while (bit < 14 && !(mask & (1 << bit))) bit++;
+    return bit;
+}
+
+void irqSet(irqMASK mask, IntFn function) {
+    int bit = irq_bit(mask);
+    if (bit < 14) handlers[bit] = function;
+}
+
+void irqEnable(int mask) {
+    REG_IE |= mask;
+}
+
+void irqDisable(int mask) {
+    REG_IE &= ~mask;
+}
+
+void host_irq_raise(irqMASK mask) {
+    int bit = irq_bit(mask);
+    if (bit < 14 && (REG_IE & mask) && handlers[bit]) {
+        REG_IF |= mask;
+        handlers[bit]();
+        REG_IF &= ~mask;
+    }
+}
@@ -0,0 +1,26 @@
+/*
+ * Host shim: GBA I/O registers as plain variables (see gba_regs_host.c)
+ *
+ * Writes are kept so host tools can inspect what the code programmed,
+ * e.g. the Timer0 reload, and feed counters back in.
+ */
+
+#ifndef HOST_GBA_REGS_H
+#define HOST_GBA_REGS_H
+
+#include "gba_base.h"
+
+extern vu16 REG_IME, REG_IE, REG_IF;
+
+extern vu16 REG_TM0CNT_L, REG_TM0CNT_H;
+extern vu16 REG_TM1CNT_L, REG_TM1CNT_H;
+extern vu16 REG_TM2CNT_L, REG_TM2CNT_H;
+extern vu16 REG_TM3CNT_L, REG_TM3CNT_H;
+
+extern vu32 REG_DMA1SAD, REG_DMA1DAD, REG_DMA1CNT;
+extern vu32 REG_DMA2SAD, REG_DMA2DAD, REG_DMA2CNT;
+
+extern vu16 REG_SOUNDCNT_L, REG_SOUNDCNT_H, REG_SOUNDCNT_X;
+extern vu32 REG_FIFO_A, REG_FIFO_B;
+
+#endif // HOST_GBA_REGS_H
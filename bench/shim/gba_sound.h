@@ -0,0 +1,26 @@
+/*
+ * Host shim for <gba_sound.h>
+ */
+
+#ifndef HOST_GBA_SOUND_H
+#define HOST_GBA_SOUND_H
+
+#include "gba_regs_host.h"
+
+#define DSOUNDCTRL_DMG25    (0 << 0)
+#define DSOUNDCTRL_DMG50    (1 << 0)
+#define DSOUNDCTRL_DMG100   (2 << 0)
+#define DSOUNDCTRL_A50      (0 << 2)
+#define DSOUNDCTRL_A100     (1 << 2)
+#define DSOUNDCTRL_B50      (0 << 3)
+#define DSOUNDCTRL_B100     (1 << 3)
+#define DSOUNDCTRL_AR       (1 << 8)
+#define DSOUNDCTRL_AL       (1 << 9)
+#define DSOUNDCTRL_ATIMER(x) ((x) << 10)
+#define DSOUNDCTRL_ARESET   (1 << 11)
+#define DSOUNDCTRL_BR       (1 << 12)
+#define DSOUNDCTRL_BL       (1 << 13)
+#define DSOUNDCTRL_BTIMER(x) ((x) << 14)
+#define DSOUNDCTRL_BRESET   (1 << 15)
+
+#endif // HOST_GBA_SOUND_H
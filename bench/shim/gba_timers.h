@@ -0,0 +1,14 @@
+/*
+ * Host shim for <gba_timers.h>
+ */
+
+#ifndef HOST_GBA_TIMERS_H
+#define HOST_GBA_TIMERS_H
+
+#include "gba_regs_host.h"
+
+#define TIMER_COUNT     (1 << 2)
+#define TIMER_IRQ       (1 << 6)
+#define TIMER_START     (1 << 7)
+
+#endif // HOST_GBA_TIMERS_H
@@ -0,0 +1,19 @@
+/*
+ * Host shim for <gba_types.h>
+ *
+ * Lets the decoder core build natively (GBM_HOST_BUILD) for benchmarking.
+ */
+
+#ifndef HOST_GBA_TYPES_H
+#define HOST_GBA_TYPES_H
+
+#include <stdint.h>
+
+typedef uint8_t  u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef int8_t   s8;
+typedef int16_t  s16;
+typedef int32_t  s32;
+
+#endif // HOST_GBA_TYPES_H
@@ -107,6 +107,23 @@ cp "$INPUT_ROM" "$OUTPUT_ROM"
 echo "Padding ROM..."
 $PADBIN_CMD 256 "$OUTPUT_ROM"
 
+# Record where the archive will start in the player's GBFS locator, so it
+# does not have to search the ROM for it (see source/media_source.c)
+GBFS_OFFSET=$(wc -c < "$OUTPUT_ROM" | tr -d ' ')
+# Only word-aligned matches, as the packager checks: the locator is a
+# 4-aligned struct, and the tag bytes can turn up elsewhere in the ROM
+LOCATOR=$(LC_ALL=C grep -obUa "GBFS@ROM" "$OUTPUT_ROM" | cut -d: -f1 |
+    while read -r OFFSET; do
+        if [ $((OFFSET % 4)) -eq 0 ]; then echo "$OFFSET"; break; fi
+    done)
+if [ -n "$LOCATOR" ]; then
+    echo "Recording archive offset $GBFS_OFFSET..."
+    LE32=$(printf '\\%03o\\%03o\\%03o\\%03o' \
+        $((GBFS_OFFSET & 255)) $(((GBFS_OFFSET >> 8) & 255)) \
+        $(((GBFS_OFFSET >> 16) & 255)) $(((GBFS_OFFSET >> 24) & 255)))
+    printf "$LE32" | dd of="$OUTPUT_ROM" bs=1 seek=$((LOCATOR + 8)) conv=notrunc 2>/dev/null
+fi
+
 # Create GBFS archive
 echo "Creating GBFS archive..."
 $GBFS_CMD media_data.gbfs $MEDIA_FILES
@@ -3,16 +3,60 @@
 
 #include <gba_types.h>
 
+// Default (and largest) frame size; M3 converter output is always this
 #define FRAME_WIDTH 240
 #define FRAME_HEIGHT 160
 #define GBM_HEADER_SIZE 0x200
 
+// Frames are coded as a grid of 8x8 macroblocks (counts for the largest size)
+#define GBM_MB_COLS (FRAME_WIDTH / 8)   // 30
+#define GBM_MB_ROWS (FRAME_HEIGHT / 8)  // 20
+#define GBM_MB_ROW_FULL ((1u << GBM_MB_COLS) - 1)
+
+// Frame size extension: "SIZE", u16 width, u16 height at this header offset.
+// Used for the 160x128 Mode 5 profile (GBM_M5_WIDTH x GBM_M5_HEIGHT);
+// without the tag a stream is FRAME_WIDTH x FRAME_HEIGHT.
+#define GBM_SIZE_TAG_OFFSET 0x1F0
+#define GBM_M5_WIDTH 160
+#define GBM_M5_HEIGHT 128
+
+// M3 streams carry no frame rate; they all play at this
+#define GBM_FRAME_RATE 10
+
+// Frame index sidecar: "<movie>.gbi" next to "<movie>.gbm" in the GBFS
+// archive, written by gbm_packager so the player need not walk every frame
+// header at startup. A GbmIndexHeader, then keyframe_count u32 offsets of
+// every keyframe_interval-th frame (the M3 I-frames, one per minute at
+// 10 fps). Offsets are from the start of the .gbm; all fields
+// little-endian, the table word aligned.
+#define GBM_INDEX_MAGIC 0x494D4247  // "GBMI"
+#define GBM_INDEX_VERSION 1
+
+typedef struct {
+    u32 magic;              // GBM_INDEX_MAGIC
+    u32 version;            // GBM_INDEX_VERSION
+    u32 gbm_size;           // Size of the .gbm indexed, to catch a stale index
+    u32 frame_count;
+    u32 keyframe_interval;  // Frames between keyframes (600)
+    u32 keyframe_count;
+    u32 frame_stride;       // Reserved, 0
+    u32 frame_entries;      // Reserved, 0
+} GbmIndexHeader;
+
+// One macroblock row (8 lines) for band decoding
+#define GBM_BAND_PIXELS (FRAME_WIDTH * 8)
+
 // GBM format versions
 #define GBM_VERSION_GEN1 0x06  // XOR key 0xD669
 #define GBM_VERSION_GEN3 0x05  // XOR key 0xD6AC
 #define GBM_VERSION_V130 0x04  // No XOR (key 0x0000)
 
+// GBM_HOST_BUILD: compile the decoder natively (see bench/) - no IWRAM sections
+#ifdef GBM_HOST_BUILD
+#define IWRAM_CODE
+#else
 #define IWRAM_CODE __attribute__((section(".iwram"), long_call))
+#endif
 
 // Context for decoding a single frame
 typedef struct {
@@ -30,15 +74,46 @@ typedef struct {
     const u16 *ref; // Reference buffer (previous frame)
 
     int row_offset;   // Current macroblock row offset in bytes
-    int block_offset; // Current block offset in bytes
+    int block_offset; // Current block offset in bytes, within the row
 } DecodeContext;
 
 // Set XOR key based on GBM version (call once after loading GBM header)
 // version: 0x06 for Gen1, 0x05 for Gen3
 void gbm_set_version(u8 version);
 
+// Read the frame size from a GBM header (see GBM_SIZE_TAG_OFFSET)
+void gbm_get_frame_size(const u8 *header, u16 *width, u16 *height);
+
+// Set the frame size for the following decodes. Frames are stored with a
+// stride of their width. width/height: multiples of 8, at most 240x160.
+// returns 0 if the size is not supported (geometry unchanged)
+int gbm_set_frame_size(u16 width, u16 height);
+
 // Initialize and decode a frame
+// dirty_rows: optional, GBM_MB_ROWS entries; bit x of entry y is set when
+//             macroblock (x, y) was written (anything but an 8x8 "00" skip)
 // returns the offset of the next frame, or 0 on error
-u32 gbm_decode_frame(const u8 *data, u32 offset, u16 *dst, const u16 *ref);
+u32 gbm_decode_frame(const u8 *data, u32 offset, u16 *dst, const u16 *ref, u32 *dirty_rows);
+
+// Called once macroblock row y_block is fully decoded
+// dirty: bit x is set when macroblock (x, y_block) was written
+typedef void (*GbmRowDone)(int y_block, u32 dirty);
+
+// Decode a frame one macroblock row at a time into two GBM_BAND_PIXELS
+// bands (stride FRAME_WIDTH): row y goes to bands[y & 1]. References are
+// read from ref, which must hold the whole previous frame and is required.
+// Codebook references reach 8 lines up, so row_done(y) may write row y - 1
+// back into ref but not row y; the last row is written after return.
+// Only dirty macroblocks of a band hold valid pixels.
+u32 gbm_decode_frame_banded(const u8 *data, u32 offset, u16 *const bands[2], const u16 *ref, GbmRowDone row_done);
+
+// Decode into a page that does not hold the reference frame everywhere,
+// e.g. the back page when double buffering: dst holds the frame before ref.
+// stale_rows: macroblocks where dst differs from ref - the dirty_rows of the
+//             decode that produced ref. Skipped stale blocks are copied from
+//             ref, so dst ends up complete.
+// dirty_rows: as for gbm_decode_frame; the next decode's stale_rows
+u32 gbm_decode_frame_paged(const u8 *data, u32 offset, u16 *dst, const u16 *ref,
+                           const u32 *stale_rows, u32 *dirty_rows);
 
 #endif // GBM_DECODER_H
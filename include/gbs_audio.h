@@ -2,7 +2,7 @@
  * GBS Audio Decoder for GBA
  *
  * Public interface for GBS audio playback.
- * Supports all 5 GBS modes from the M3 Movie Player.
+ * Supports all 5 GBS modes from the M3 Movie Player, plus raw 8-bit PCM.
  */
 
 #ifndef GBS_AUDIO_H
@@ -12,13 +12,19 @@
 #include <stdbool.h>
 #include <stdint.h>
 
+// Header before the audio data (block 0 starts here)
+#define GBS_HEADER_SIZE     0x200
+
 // GBS audio modes
 typedef enum {
     GBS_MODE_STEREO_4BIT   = 0,  // Stereo 4-bit IMA ADPCM, 22050 Hz, block 0x400
-    GBS_MODE_MONO_3BIT     = 1,  // Mono 3-bit ADPCM, 11025 Hz, block 0x400
-    GBS_MODE_MONO_4BIT     = 2,  // Mono 4-bit IMA ADPCM, 11025 Hz, block 0x200
+    GBS_MODE_MONO_3BIT     = 1,  // Mono 3-bit ADPCM, 44100 Hz, block 0x400
+    GBS_MODE_MONO_4BIT     = 2,  // Mono 4-bit IMA ADPCM, 22050 Hz, block 0x200
     GBS_MODE_MONO_2BIT     = 3,  // Mono 2-bit ADPCM, 22050 Hz, block 0x200
-    GBS_MODE_MONO_2BIT_SM  = 4,  // Mono 2-bit ADPCM, 22050 Hz, block 0x100 (small)
+    GBS_MODE_MONO_2BIT_SM  = 4,  // Mono 2-bit ADPCM, 11025 Hz, block 0x100 (small)
+    GBS_MODE_PCM8_MONO     = 5,  // Mono signed 8-bit PCM, rate in header (not M3)
+    GBS_MODE_PCM8_STEREO   = 6,  // Stereo signed 8-bit PCM, left then right (not M3)
+    GBS_MODE_COUNT,
     GBS_MODE_INVALID       = 255
 } GbsMode;
 
@@ -28,6 +34,7 @@ typedef struct {
     uint32_t sample_rate;
     uint8_t channels;           // 1=mono, 2=stereo
     uint32_t block_size;
+    uint32_t buffer_samples;    // Samples per ring buffer, one Timer1 IRQ each
     uint32_t total_blocks;
     uint32_t total_samples;     // Per channel for stereo
     uint32_t samples_decoded;
@@ -35,6 +42,19 @@ typedef struct {
     bool is_finished;
 } GbsAudioInfo;
 
+// Playback telemetry (builds with GBS_AUDIO_STATS=1, see gbs_audio_get_stats)
+typedef struct {
+    uint32_t irq_count;         // Timer1 IRQs (buffer boundaries) serviced
+    uint32_t late_swaps;        // IRQs entered after the next buffer's first sample
+    uint32_t max_late_samples;  // Worst of those, in samples
+    uint32_t underruns;         // Boundaries with nothing queued: buffer replayed
+    uint32_t irq_decodes;       // Buffers decoded in the IRQ, not the main loop
+    uint32_t silence_samples;   // Samples zero-filled past the end of the data
+    uint32_t irq_cycles_max;    // Longest Timer1 IRQ, in CPU cycles
+    uint32_t irq_cycles_mean;   // Mean Timer1 IRQ, in CPU cycles
+    uint32_t blocks_decoded[GBS_MODE_COUNT];   // Per mode; PCM counts samples
+} GbsAudioStats;
+
 /*
  * Initialize the GBS audio system with embedded data.
  *
@@ -44,6 +64,50 @@ typedef struct {
  */
 bool gbs_audio_init(const uint8_t* gbs_data, uint32_t gbs_size);
 
+// Streaming block source: the address of block n of the audio data (n
+// from 0, the block after the header), or the address of a block to
+// replay in its place if it cannot be had at once. Called from the main
+// loop with may_wait set, and from the Timer1 IRQ without: the IRQ must
+// not wait on a device read. The block must stay readable until the next
+// call.
+typedef const uint8_t* (*GbsBlockFetch)(uint32_t block, bool may_wait);
+
+/*
+ * Initialize the GBS audio system for data that is not memory-mapped:
+ * blocks are read through fetch as the decoder reaches them (see
+ * media_stream_open_gbs). PCM modes cannot be streamed and are rejected.
+ *
+ * @param header      The first GBS_HEADER_SIZE bytes of the file; kept
+ * @param gbs_size    Size of the whole file in bytes
+ * @param fetch       Block source
+ * @return            true if initialization successful
+ */
+bool gbs_audio_init_stream(const uint8_t* header, uint32_t gbs_size, GbsBlockFetch fetch);
+
+/*
+ * Validate GBS data and describe it without touching playback: fills the
+ * mode, rate, channels, block size and totals of info (buffer_samples and
+ * samples_decoded are left 0). gbs_audio_init() accepts exactly the data
+ * this accepts.
+ *
+ * @param info  Output; mode is GBS_MODE_INVALID if the data is rejected
+ * @return      true if the data can be played
+ */
+bool gbs_audio_probe(const uint8_t* gbs_data, uint32_t gbs_size, GbsAudioInfo* info);
+
+/*
+ * Set the audio buffer length, as a latency in milliseconds, for the next
+ * gbs_audio_init(). Shorter buffers start seeks sooner but take more Timer1
+ * IRQs per second. The length is rounded to a multiple of 16 samples and
+ * kept within 128 samples and the buffer pool (1024 unless the build sets
+ * AUDIO_BUFFER_SAMPLES). 0, the default, gives about 46 ms at every rate
+ * the pool allows (1024 samples at 22050 Hz), unless the GBS header
+ * carries a latency tag (gbm_packager -l).
+ *
+ * @param ms  Buffer latency in milliseconds, or 0 for the default
+ */
+void gbs_audio_set_buffer_ms(uint32_t ms);
+
 /*
  * Start audio playback.
  * Call this after gbs_audio_init().
@@ -65,6 +129,15 @@ void gbs_audio_pause(void);
  */
 void gbs_audio_resume(void);
 
+/*
+ * Decode audio ahead into the buffer ring.
+ * Call from the main loop, idle waits and long decodes (e.g. between
+ * macroblock rows); cheap when the ring is full. If the ring runs dry the
+ * buffer on air is replayed and the Timer1 IRQ decodes the next one
+ * itself, so playback recovers at the next buffer.
+ */
+void gbs_audio_update(void);
+
 /*
  * Check if audio is paused.
  */
@@ -72,9 +145,17 @@ bool gbs_audio_is_paused(void);
 
 /*
  * Restart playback from beginning.
+ * Same as gbs_audio_seek_sample(0).
  */
 void gbs_audio_restart(void);
 
+/*
+ * Loop playback: the decoder runs from the last sample straight into the
+ * first, with no gap, instead of finishing. Off after gbs_audio_init().
+ * gbs_audio_get_position() wraps to 0 when the start is heard again.
+ */
+void gbs_audio_set_loop(bool loop);
+
 /*
  * Check if audio is currently playing.
  */
@@ -103,12 +184,32 @@ void gbs_audio_shutdown(void);
 
 /*
  * Seek to a specific minute in the audio.
- * Audio will stop, seek, and restart.
+ * Same as gbs_audio_seek_sample() at the minute's first sample.
  *
  * @param minute  Target minute (0-based)
  */
 void gbs_audio_seek_minute(uint32_t minute);
 
+/*
+ * Seek to an exact sample (per channel); playback resumes with that sample.
+ * While playing, timers and DMA keep running: the buffer on air plays out
+ * and the target follows it at the buffer boundary, with no gap. Otherwise
+ * audio restarts at the target. Costs at most one block of decoding plus
+ * refilling the buffer ring.
+ * A target past the end wraps to the beginning, as gbs_audio_seek_minute.
+ *
+ * @param sample  Target sample (0-based)
+ */
+void gbs_audio_seek_sample(uint64_t sample);
+
+/*
+ * Seek to a time in milliseconds, rounded down to the sample.
+ * Same as gbs_audio_seek_sample(ms * sample_rate / 1000).
+ *
+ * @param ms  Target time (0-based)
+ */
+void gbs_audio_seek_ms(uint32_t ms);
+
 /*
  * Get current playback position in minutes.
  */
@@ -120,10 +221,42 @@ uint32_t gbs_audio_get_current_minute(void);
 uint32_t gbs_audio_get_total_minutes(void);
 
 /*
- * Check if audio crossed a minute boundary since last check.
- * Returns the new minute number if crossed, or -1 if not.
- * Calling this clears the pending flag.
+ * Get the playback position: the sample (per channel) being played now.
+ * Sample accurate - counts the samples Timer1 has clocked out of the
+ * current buffer - so it can serve as the A/V master clock.
+ * Holds still while paused; safe to call from the main loop at any time.
+ */
+uint32_t gbs_audio_get_position(void);
+
+/*
+ * Get how many times looping playback has wrapped back to the start, as
+ * heard - it steps when gbs_audio_get_position() wraps to 0.
+ */
+uint32_t gbs_audio_get_loop_count(void);
+
+/*
+ * Copy the playback telemetry gathered since startup or the last
+ * gbs_audio_reset_stats(). Only kept in builds with GBS_AUDIO_STATS=1,
+ * which use Timer2 and Timer3 to time the Timer1 IRQ; otherwise the
+ * counters cost nothing, read as zero and this returns false.
+ *
+ * @param stats  Filled with a consistent snapshot
+ * @return       true if the build keeps telemetry
+ */
+bool gbs_audio_get_stats(GbsAudioStats* stats);
+
+/*
+ * Clear the telemetry counters.
+ */
+void gbs_audio_reset_stats(void);
+
+/*
+ * Write a telemetry snapshot to SRAM for offline analysis: "GBST", the
+ * record size (u32), then the GbsAudioStats fields, little-endian, at
+ * GBS_STATS_SRAM_OFFSET (default 0). bench/gbs_stats prints a saved record.
+ *
+ * @return  false, writing nothing, in builds without GBS_AUDIO_STATS
  */
-int32_t gbs_audio_check_minute_sync(void);
+bool gbs_audio_save_stats(void);
 
 #endif // GBS_AUDIO_H
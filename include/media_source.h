@@ -4,7 +4,8 @@
  * Provides a unified interface for loading media data from different sources:
  * - GBFS (appended to ROM)
  * - Embedded data (compiled into ROM)
- * - SD card (future)
+ * - A GBFS archive on a block device, e.g. an SD card (MEDIA_SOURCE_STREAM
+ *   builds, read through media_stream.h)
  *
  * Supports both GBS (audio) and GBM (video) files.
  */
@@ -15,12 +16,14 @@
 #include <stdbool.h>
 #include <stdint.h>
 
+#include "media_stream.h"
+
 // Media source types
 typedef enum {
     MEDIA_SOURCE_NONE = 0,
     MEDIA_SOURCE_EMBEDDED,  // Compiled into ROM via bin2o
     MEDIA_SOURCE_GBFS,      // GBFS filesystem appended to ROM
-    MEDIA_SOURCE_SDCARD     // SD card (future)
+    MEDIA_SOURCE_SDCARD     // Block device (media_source_init_device)
 } MediaSourceType;
 
 // Media file types
@@ -30,6 +33,34 @@ typedef enum {
     MEDIA_TYPE_GBM          // Video file
 } MediaFileType;
 
+// Catalog entry: one media file and the header facts its consumers need,
+// read once at media_source_init
+typedef struct {
+    MediaFileType type;
+    const uint8_t* data;        // NULL on a block device: see offset
+    uint32_t offset;            // Block device: byte offset of the file
+    uint32_t size;
+    char name[25];              // GBFS names are up to 24 characters
+
+    // GBM (video)
+    uint8_t gbm_version;        // Header byte 0x10, for gbm_set_version
+    uint8_t frame_rate;         // Frames per second
+    uint16_t width, height;     // Frame size (see GBM_SIZE_TAG_OFFSET)
+    uint32_t frame_count;       // From the frame index, 0 if unknown
+    const uint8_t* index;       // Frame index ("<name>.gbi"), NULL if none;
+                                // from a block device, keyframes only
+    uint32_t index_size;
+
+    // GBS (audio)
+    uint8_t gbs_mode;           // GbsMode
+    uint8_t channels;
+    uint32_t sample_rate;
+    uint32_t duration_ms;
+} MediaEntry;
+
+// Files the catalog holds at most; the rest are ignored
+#define MEDIA_CATALOG_MAX 64
+
 // Media source info
 typedef struct {
     MediaSourceType source;
@@ -41,15 +72,42 @@ typedef struct {
 
 /*
  * Initialize the media source system.
- * Call this once at startup.
+ * Call this once at startup. The GBFS archive is taken from the offset
+ * the packager patched into the player ROM, or else searched for.
+ * Builds the catalog: every .gbm and .gbs whose header checks out, with
+ * its metadata, so nothing needs to walk the archive or parse headers again.
  *
  * @return true if initialization successful
  */
 bool media_source_init(void);
 
+#if MEDIA_SOURCE_STREAM
+/*
+ * Initialize the media source system from a GBFS archive stored from the
+ * first sector of a block device (media_stream_mount). Builds the catalog
+ * as media_source_init does, reading only the directory and file headers:
+ * entries have no data pointer, only their offset on the device, and
+ * frame indexes are copied to EWRAM without their per-frame tables.
+ * Play the files with media_stream_stage_frame / media_stream_open_gbs.
+ *
+ * @param device  The device, from a cart driver or media_source_rom_device
+ * @return        true if it holds media
+ */
+bool media_source_init_device(const MediaBlockDevice* device);
+
+/*
+ * The GBFS archive appended to this ROM, presented as a block device, so a
+ * streaming build runs on any cart or emulator until an SD driver supplies
+ * its own MediaBlockDevice.
+ *
+ * @return  The device, or NULL if the ROM carries no archive
+ */
+const MediaBlockDevice* media_source_rom_device(void);
+#endif
+
 /*
  * Find and load the first available GBS audio file.
- * Searches in order: GBFS, then embedded data.
+ * Same as catalog entry 0 of MEDIA_TYPE_GBS.
  *
  * @param info  Output: filled with source information
  * @return      true if audio found
@@ -58,7 +116,7 @@ bool media_source_find_gbs(MediaSourceInfo* info);
 
 /*
  * Find and load the first available GBM video file.
- * Searches in order: GBFS, then embedded data.
+ * Same as catalog entry 0 of MEDIA_TYPE_GBM.
  *
  * @param info  Output: filled with source information
  * @return      true if video found
@@ -82,6 +140,15 @@ bool media_source_load_file(const char* filename, MediaSourceInfo* info);
  */
 uint32_t media_source_count(MediaFileType type);
 
+/*
+ * Get a catalog entry, in archive (name) order: 0 .. media_source_count(type) - 1.
+ *
+ * @param type  MEDIA_TYPE_GBS or MEDIA_TYPE_GBM
+ * @param n     Index among files of that type
+ * @return      The entry, or NULL if out of range
+ */
+const MediaEntry* media_source_get_entry(MediaFileType type, uint32_t n);
+
 /*
  * Get the currently active source type.
  */
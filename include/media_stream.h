@@ -0,0 +1,124 @@
+/*
+ * Streaming Media Access
+ *
+ * Reads media that are not memory-mapped - an SD card behind a flash cart,
+ * or anything else addressed in 512-byte sectors - through a cache of
+ * MEDIA_CHUNK_SIZE chunks in EWRAM. Each open stream (the video, the audio)
+ * keeps MEDIA_READAHEAD_CHUNKS chunks past its read position filled by
+ * media_stream_prefetch() in idle time, so playback reads from the cache
+ * and waits on the device only if it outruns the read-ahead.
+ *
+ * Compiled in builds with MEDIA_SOURCE_STREAM=1, which play from a block
+ * device (media_source_init_device) instead of from ROM.
+ */
+
+#ifndef MEDIA_STREAM_H
+#define MEDIA_STREAM_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifndef MEDIA_SOURCE_STREAM
+#define MEDIA_SOURCE_STREAM 0
+#endif
+
+#define MEDIA_SECTOR_SIZE 512
+
+// A block device. read is blocking and is only entered from the main
+// loop, never from the audio IRQ.
+typedef struct {
+    bool (*read)(uint32_t sector, uint32_t count, void* dst);
+    uint32_t sector_count;
+} MediaBlockDevice;
+
+// Cache geometry. A chunk is one device read, a multiple of the sector
+// size; the default cache (8 x 8 KB) and the frame staging buffer take
+// 128 KB of EWRAM.
+#ifndef MEDIA_CHUNK_SIZE
+#define MEDIA_CHUNK_SIZE 8192
+#endif
+#ifndef MEDIA_CACHE_CHUNKS
+#define MEDIA_CACHE_CHUNKS 8
+#endif
+#ifndef MEDIA_READAHEAD_CHUNKS
+#define MEDIA_READAHEAD_CHUNKS 3
+#endif
+
+// Streams read ahead at once (video and audio)
+#define MEDIA_STREAMS_MAX 2
+
+// A file on the device
+typedef struct {
+    uint32_t start;             // Byte offset on the device
+    uint32_t size;
+    volatile uint32_t position; // Read-ahead follows this file offset
+} MediaStream;
+
+// Cache counters since media_stream_mount
+typedef struct {
+    uint32_t hits;              // Chunk lookups served from the cache
+    uint32_t misses;            // Lookups that waited on the device
+    uint32_t prefetches;        // Chunks read ahead in idle time
+    uint32_t device_reads;      // Read commands issued
+    uint32_t device_bytes;
+    uint32_t audio_replays;     // Audio blocks not to hand: previous block replayed
+} MediaStreamStats;
+
+/*
+ * Use a block device; empties the cache and closes all streams.
+ *
+ * @return  false if device is NULL or empty
+ */
+bool media_stream_mount(const MediaBlockDevice* device);
+
+/*
+ * Copy len bytes at a device byte offset, through the cache (blocking).
+ *
+ * @return  false on a device error or a read past the end
+ */
+bool media_stream_read(uint32_t offset, void* dst, uint32_t len);
+
+/*
+ * Open a stream over size bytes at device offset start and read ahead
+ * from its beginning. At most MEDIA_STREAMS_MAX are open; the first
+ * opened is read ahead first.
+ *
+ * @return  false if no stream slot is free
+ */
+bool media_stream_open(MediaStream* stream, uint32_t start, uint32_t size);
+
+/*
+ * Read one chunk ahead for the open streams, if any is short of its
+ * read-ahead. Call from idle waits; costs one device read at most.
+ *
+ * @return  true if a chunk was read
+ */
+bool media_stream_prefetch(void);
+
+/*
+ * Stage the GBM frame at a file offset of a video stream - its u16 length,
+ * then the payload - in EWRAM, for gbm_decode_frame(frame, 0, ...). The
+ * stream reads ahead from the next frame (offset + 2 + length).
+ *
+ * @return  The staged frame, or NULL at the end of the video or on error
+ */
+const uint8_t* media_stream_stage_frame(MediaStream* stream, uint32_t offset);
+
+/*
+ * Open an audio stream over a GBS file and initialize GBS playback from
+ * it (gbs_audio_init_stream): the header is staged in EWRAM and blocks
+ * are served from the cache, which keeps the chunk of the block being
+ * decoded until the next is fetched. The Timer1 IRQ never reads the
+ * device: if a block it needs is not cached, the previous block is
+ * replayed rather than waiting (counted in audio_replays).
+ *
+ * @return  false if the file cannot be streamed (see gbs_audio_init_stream)
+ */
+bool media_stream_open_gbs(MediaStream* stream, uint32_t start, uint32_t size);
+
+/*
+ * Copy the cache counters.
+ */
+void media_stream_get_stats(MediaStreamStats* stats);
+
+#endif // MEDIA_STREAM_H
@@ -4,11 +4,29 @@
  * Embeds M3_Movie_Player.gba and packages user-provided
  * .gbm and .gbs files into a playable GBA ROM.
  *
+ * A .wav (PCM, 8 or 16-bit, mono or stereo, 11025/22050/44100 Hz) can be
+ * given instead of the .gbs: it is quantized to signed 8-bit and packaged
+ * as a raw PCM GBS (mode 5 mono, 6 stereo), which the player plays by DMA
+ * straight from ROM with no decoding - more ROM, less CPU.
+ *
  * Usage:
  *   gbm_packager input.gbm input.gbs              -> generates input.gba
  *   gbm_packager output.gba input.gbm input.gbs   -> generates output.gba
+ *   gbm_packager input.gbm input.wav              -> same, with PCM audio
+ *   gbm_packager -l ms ...                        -> audio buffer latency
+ *
+ * -l sets the player's audio buffer length for this title (a "BUFM" tag in
+ * the GBS header): shorter buffers react sooner to seeks, longer ones take
+ * fewer audio IRQs per second. Without it the player uses about 46 ms.
+ * The player rounds it to 16 samples and keeps it to 128-1024 samples at
+ * the title's rate (3-23 ms at 44100 Hz, 6-46 at 22050, 12-93 at 11025),
+ * so -l takes 3-93 ms and a value outside the rate's range is clamped.
+ *
+ * The archive also gets movie.gbi, an index of the movie's keyframe offsets
+ * (every 600th frame), so the player seeks without scanning the .gbm at
+ * startup.
  *
- * Drag & drop: drag both .gbm and .gbs files onto the exe
+ * Drag & drop: drag both .gbm and .gbs (or .wav) files onto the exe
  */
 
 #include <stdio.h>
@@ -44,6 +62,28 @@ typedef struct {
     uint32_t data_offset;
 } __attribute__((packed)) GBFSEntry;
 
+#define GBM_HEADER_SIZE 0x200
+#define GBM_KEYFRAME_INTERVAL 600   // M3 I-frames: one per minute at 10 fps
+
+// Frame index (see GbmIndexHeader in include/gbm_decoder.h)
+#define GBM_INDEX_MAGIC "GBMI"
+#define GBM_INDEX_VERSION 1
+#define GBM_INDEX_HEADER_SIZE 32
+
+// Player's GBFS locator (source/media_source.c): tag, then u32 archive offset
+#define GBFS_LOCATOR_TAG "GBFS@ROM"
+#define GBFS_LOCATOR_TAG_LEN 8
+
+#define GBS_HEADER_SIZE 0x200
+#define GBS_BUFFER_TAG_OFFSET 0x1F0
+
+// -l range: the player keeps buffers to 128-1024 samples, 3 ms at 44100 Hz
+// up to 93 ms at 11025 Hz
+#define BUFFER_MS_MIN 3
+#define BUFFER_MS_MAX 93
+#define GBS_MODE_PCM8_MONO 5
+#define GBS_MODE_PCM8_STEREO 6
+
 static uint32_t align4(uint32_t x) {
     return (x + 3) & ~3;
 }
@@ -86,36 +126,184 @@ static void make_unique_path(char* path, size_t max_len) {
     }
 }
 
-static int create_gbfs(const char* gbm_path, const char* gbs_path,
-                       uint8_t** out_data, uint32_t* out_size) {
-    FILE* gbm = fopen(gbm_path, "rb");
-    FILE* gbs = fopen(gbs_path, "rb");
+static uint8_t* load_file(const char* path, uint32_t* size) {
+    FILE* f = fopen(path, "rb");
+    if (!f) return NULL;
 
-    if (!gbm || !gbs) {
-        if (gbm) fclose(gbm);
-        if (gbs) fclose(gbs);
-        return -1;
+    fseek(f, 0, SEEK_END);
+    long len = ftell(f);
+    fseek(f, 0, SEEK_SET);
+
+    uint8_t* data = malloc(len > 0 ? len : 1);
+    if (data && fread(data, 1, len, f) != (size_t)len) {
+        free(data);
+        data = NULL;
+    }
+    fclose(f);
+
+    *size = (uint32_t)len;
+    return data;
+}
+
+static uint32_t read_le16(const uint8_t* p) {
+    return p[0] | (p[1] << 8);
+}
+
+static uint32_t read_le32(const uint8_t* p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void write_le32(uint8_t* p, uint32_t v) {
+    p[0] = v & 0xFF;
+    p[1] = (v >> 8) & 0xFF;
+    p[2] = (v >> 16) & 0xFF;
+    p[3] = v >> 24;
+}
+
+// Convert a PCM .wav to a raw 8-bit PCM GBS: header, then all left samples,
+// then (stereo) all right samples. 16-bit samples are rounded to 8 bits.
+static uint8_t* wav_to_gbs(const char* wav_path, uint32_t* out_size) {
+    uint32_t wav_size;
+    uint8_t* wav = load_file(wav_path, &wav_size);
+    if (!wav) return NULL;
+
+    if (wav_size < 12 || memcmp(wav, "RIFF", 4) != 0 || memcmp(wav + 8, "WAVE", 4) != 0) {
+        fprintf(stderr, "Error: %s is not a WAV file\n", wav_path);
+        free(wav);
+        return NULL;
+    }
+
+    // Find the fmt and data chunks
+    const uint8_t* fmt = NULL;
+    const uint8_t* samples = NULL;
+    uint32_t data_len = 0;
+    uint32_t pos = 12;
+    while (pos + 8 <= wav_size) {
+        uint32_t len = read_le32(wav + pos + 4);
+        uint32_t avail = wav_size - pos - 8;
+        if (memcmp(wav + pos, "fmt ", 4) == 0 && len >= 16 && len <= avail) {
+            fmt = wav + pos + 8;
+        } else if (memcmp(wav + pos, "data", 4) == 0) {
+            samples = wav + pos + 8;
+            data_len = len < avail ? len : avail;
+        }
+        // A chunk running past the end is the last (a truncated data chunk
+        // is kept above); stepping over it could wrap pos round
+        if (len >= avail) break;
+        pos += 8 + len + (len & 1);
+    }
+
+    uint32_t channels = fmt ? read_le16(fmt + 2) : 0;
+    uint32_t rate = fmt ? read_le32(fmt + 4) : 0;
+    uint32_t bits = fmt ? read_le16(fmt + 14) : 0;
+    if (!fmt || !samples || read_le16(fmt) != 1 ||
+        (channels != 1 && channels != 2) || (bits != 8 && bits != 16)) {
+        fprintf(stderr, "Error: %s must be 8 or 16-bit PCM, mono or stereo\n", wav_path);
+        free(wav);
+        return NULL;
+    }
+    if (rate != 11025 && rate != 22050 && rate != 44100) {
+        fprintf(stderr, "Error: %s is %u Hz; resample to 11025, 22050 or 44100 Hz\n",
+                wav_path, rate);
+        free(wav);
+        return NULL;
+    }
+
+    uint32_t frame_bytes = channels * bits / 8;
+    uint32_t frames = data_len / frame_bytes;
+
+    // Planes padded with silence to a multiple of 4 samples, so the right
+    // plane starts word aligned and plays by DMA from ROM like the left
+    uint32_t plane_len = (frames + 3) & ~3u;
+
+    *out_size = GBS_HEADER_SIZE + plane_len * channels;
+    uint8_t* gbs = calloc(1, *out_size);
+    if (!gbs) {
+        free(wav);
+        return NULL;
+    }
+
+    memcpy(gbs, "GBAL", 4);
+    write_le32(gbs + 4, *out_size);
+    memcpy(gbs + 8, "MUSI", 4);
+    write_le32(gbs + 12, rate);
+    write_le32(gbs + 16, channels == 2 ? GBS_MODE_PCM8_STEREO : GBS_MODE_PCM8_MONO);
+
+    for (uint32_t c = 0; c < channels; c++) {
+        int8_t* plane = (int8_t*)gbs + GBS_HEADER_SIZE + c * plane_len;
+        for (uint32_t i = 0; i < frames; i++) {
+            const uint8_t* p = samples + i * frame_bytes + c * bits / 8;
+            int v;
+            if (bits == 8) {
+                v = p[0] - 128;
+            } else {
+                v = ((int16_t)read_le16(p) + 128) >> 8;
+                if (v > 127) v = 127;
+            }
+            plane[i] = (int8_t)v;
+        }
     }
 
-    fseek(gbm, 0, SEEK_END);
-    uint32_t gbm_size = ftell(gbm);
-    fseek(gbm, 0, SEEK_SET);
+    free(wav);
+    return gbs;
+}
 
-    fseek(gbs, 0, SEEK_END);
-    uint32_t gbs_size = ftell(gbs);
-    fseek(gbs, 0, SEEK_SET);
+// Frame index for a .gbm: the frame walk the player would do at startup
+// (2-byte length, then the frame; a length of 0 or 0xFFFF ends the stream)
+static uint8_t* build_frame_index(const uint8_t* gbm, uint32_t gbm_size, uint32_t* out_size) {
+    uint32_t frame_count = 0;
+    uint32_t offset = GBM_HEADER_SIZE;
+    while (offset + 2 < gbm_size) {
+        uint32_t frame_len = read_le16(gbm + offset);
+        if (frame_len == 0 || frame_len == 0xFFFF) break;
+        offset += 2 + frame_len;
+        frame_count++;
+    }
 
+    uint32_t keyframes = (frame_count + GBM_KEYFRAME_INTERVAL - 1) / GBM_KEYFRAME_INTERVAL;
+    *out_size = GBM_INDEX_HEADER_SIZE + 4 * keyframes;
+
+    uint8_t* index = calloc(1, *out_size);
+    if (!index) return NULL;
+
+    memcpy(index, GBM_INDEX_MAGIC, 4);
+    write_le32(index + 4, GBM_INDEX_VERSION);
+    write_le32(index + 8, gbm_size);
+    write_le32(index + 12, frame_count);
+    write_le32(index + 16, GBM_KEYFRAME_INTERVAL);
+    write_le32(index + 20, keyframes);
+    // frame_stride and frame_entries (bytes 24-31) are reserved, left 0
+
+    uint8_t* keyframe_table = index + GBM_INDEX_HEADER_SIZE;
+    offset = GBM_HEADER_SIZE;
+    for (uint32_t frame = 0; frame < frame_count; frame++) {
+        if (frame % GBM_KEYFRAME_INTERVAL == 0) {
+            write_le32(keyframe_table + 4 * (frame / GBM_KEYFRAME_INTERVAL), offset);
+        }
+        offset += 2 + read_le16(gbm + offset);
+    }
+    return index;
+}
+
+typedef struct {
+    const char* name;
+    const uint8_t* data;
+    uint32_t size;
+} GbfsObject;
+
+// Archive the objects, each word aligned. GBFS looks names up by binary
+// search, so objects must be given sorted by name.
+static int create_gbfs(const GbfsObject* objects, uint32_t count,
+                       uint8_t** out_data, uint32_t* out_size) {
     uint32_t header_size = sizeof(GBFSHeader);
-    uint32_t dir_size = 2 * sizeof(GBFSEntry);
-    uint32_t data_start = align4(header_size + dir_size);
-    uint32_t gbm_offset = data_start;
-    uint32_t gbs_offset = align4(gbm_offset + gbm_size);
-    uint32_t total_size = align4(gbs_offset + gbs_size);
+    uint32_t dir_size = count * sizeof(GBFSEntry);
+    uint32_t total_size = align4(header_size + dir_size);
+    for (uint32_t i = 0; i < count; i++) {
+        total_size = align4(total_size + objects[i].size);
+    }
 
     uint8_t* data = calloc(1, total_size);
     if (!data) {
-        fclose(gbm);
-        fclose(gbs);
         return -1;
     }
 
@@ -123,33 +311,47 @@ static int create_gbfs(const char* gbm_path, const char* gbs_path,
     memcpy(hdr->magic, GBFS_MAGIC, GBFS_MAGIC_LEN);
     hdr->total_len = total_size;
     hdr->dir_off = header_size;
-    hdr->dir_nmemb = 2;
+    hdr->dir_nmemb = count;
 
     GBFSEntry* entries = (GBFSEntry*)(data + header_size);
-    strncpy(entries[0].name, "movie.gbm", GBFS_NAME_LEN);
-    entries[0].len = gbm_size;
-    entries[0].data_offset = gbm_offset;
-    strncpy(entries[1].name, "movie.gbs", GBFS_NAME_LEN);
-    entries[1].len = gbs_size;
-    entries[1].data_offset = gbs_offset;
-
-    fread(data + gbm_offset, 1, gbm_size, gbm);
-    fread(data + gbs_offset, 1, gbs_size, gbs);
-
-    fclose(gbm);
-    fclose(gbs);
+    uint32_t offset = align4(header_size + dir_size);
+    for (uint32_t i = 0; i < count; i++) {
+        strncpy(entries[i].name, objects[i].name, GBFS_NAME_LEN);
+        entries[i].len = objects[i].size;
+        entries[i].data_offset = offset;
+        memcpy(data + offset, objects[i].data, objects[i].size);
+        offset = align4(offset + objects[i].size);
+    }
 
     *out_data = data;
     *out_size = total_size;
     return 0;
 }
 
+// Record the archive's ROM offset in the player's locator, so it need not
+// search the ROM for it. Returns 0 if the player has no locator.
+static int patch_gbfs_locator(uint8_t* rom, uint32_t rom_size, uint32_t gbfs_offset) {
+    for (uint32_t i = 0; i + GBFS_LOCATOR_TAG_LEN + 4 <= rom_size; i += 4) {
+        if (memcmp(rom + i, GBFS_LOCATOR_TAG, GBFS_LOCATOR_TAG_LEN) == 0) {
+            write_le32(rom + i + GBFS_LOCATOR_TAG_LEN, gbfs_offset);
+            return 1;
+        }
+    }
+    return 0;
+}
+
 static void print_usage(const char* prog) {
-    fprintf(stderr, "Ausar's GBM Packager V0.2 - Create GBA movie ROMs\n\n");
+    fprintf(stderr, "Ausar's GBM Packager V0.3 - Create GBA movie ROMs\n\n");
     fprintf(stderr, "Usage:\n");
     fprintf(stderr, "  %s input.gbm input.gbs              (auto-generates input.gba)\n", prog);
     fprintf(stderr, "  %s output.gba input.gbm input.gbs   (explicit output name)\n", prog);
-    fprintf(stderr, "\nDrag & drop: drag both .gbm and .gbs files onto this exe\n");
+    fprintf(stderr, "  %s -l ms ...                        (audio buffer latency, 3-93 ms)\n", prog);
+    fprintf(stderr, "\nA .wav (8/16-bit PCM, 11025/22050/44100 Hz) can replace the .gbs:\n");
+    fprintf(stderr, "it is stored as 8-bit PCM, which plays with no decoding but takes\n");
+    fprintf(stderr, "2-4x the ROM of a .gbs.\n");
+    fprintf(stderr, "\nThe player clamps -l to 128-1024 samples at the title's rate:\n");
+    fprintf(stderr, "3-23 ms at 44100 Hz, 6-46 ms at 22050 Hz, 12-93 ms at 11025 Hz.\n");
+    fprintf(stderr, "\nDrag & drop: drag both .gbm and .gbs (or .wav) files onto this exe\n");
 }
 
 int main(int argc, char** argv) {
@@ -157,19 +359,32 @@ int main(int argc, char** argv) {
     const char* gbm_path = NULL;
     const char* gbs_path = NULL;
     char auto_output[512] = {0};
+    const char* prog = argv[0];
+
+    // Optional audio buffer latency, stored in the GBS header for the player
+    int buffer_ms = -1;
+    if (argc >= 3 && strcmp(argv[1], "-l") == 0) {
+        buffer_ms = atoi(argv[2]);
+        if (buffer_ms < BUFFER_MS_MIN || buffer_ms > BUFFER_MS_MAX) {
+            print_usage(prog);
+            return 1;
+        }
+        argc -= 2;
+        argv += 2;
+    }
 
     if (argc == 3) {
         // Auto mode: two input files, determine which is which
         for (int i = 1; i <= 2; i++) {
             if (ends_with(argv[i], ".gbm")) {
                 gbm_path = argv[i];
-            } else if (ends_with(argv[i], ".gbs")) {
+            } else if (ends_with(argv[i], ".gbs") || ends_with(argv[i], ".wav")) {
                 gbs_path = argv[i];
             }
         }
         if (!gbm_path || !gbs_path) {
-            fprintf(stderr, "Error: Need one .gbm and one .gbs file\n");
-            print_usage(argv[0]);
+            fprintf(stderr, "Error: Need one .gbm and one .gbs (or .wav) file\n");
+            print_usage(prog);
             return 1;
         }
         // Generate output name from gbm file
@@ -185,32 +400,75 @@ int main(int argc, char** argv) {
         gbm_path = argv[2];
         gbs_path = argv[3];
     } else {
-        print_usage(argv[0]);
+        print_usage(prog);
         return 1;
     }
 
+    // Audio: a .gbs as is, or a .wav converted to 8-bit PCM
+    uint32_t gbs_size = 0;
+    uint8_t* gbs_data = ends_with(gbs_path, ".wav") ? wav_to_gbs(gbs_path, &gbs_size)
+                                                    : load_file(gbs_path, &gbs_size);
+
+    if (gbs_data && buffer_ms > 0 && gbs_size >= GBS_HEADER_SIZE) {
+        uint8_t* tag = gbs_data + GBS_BUFFER_TAG_OFFSET;
+        memcpy(tag, "BUFM", 4);
+        tag[4] = buffer_ms & 0xFF;
+        tag[5] = buffer_ms >> 8;
+    }
+
+    uint32_t gbm_size = 0;
+    uint8_t* gbm_data = load_file(gbm_path, &gbm_size);
+
+    uint32_t index_size = 0;
+    uint8_t* index_data = gbm_data ? build_frame_index(gbm_data, gbm_size, &index_size) : NULL;
+
+    // Sorted by name (see create_gbfs)
+    GbfsObject objects[] = {
+        { "movie.gbi", index_data, index_size },
+        { "movie.gbm", gbm_data, gbm_size },
+        { "movie.gbs", gbs_data, gbs_size },
+    };
+
     uint8_t* gbfs_data = NULL;
     uint32_t gbfs_size = 0;
 
-    if (create_gbfs(gbm_path, gbs_path, &gbfs_data, &gbfs_size) != 0) {
+    if (!gbs_data || !index_data ||
+        create_gbfs(objects, sizeof(objects) / sizeof(objects[0]), &gbfs_data, &gbfs_size) != 0) {
         fprintf(stderr, "Error: Failed to read input files\n");
         fprintf(stderr, "  GBM: %s\n", gbm_path);
         fprintf(stderr, "  GBS: %s\n", gbs_path);
+        free(gbs_data);
+        free(gbm_data);
+        free(index_data);
         return 1;
     }
+    free(gbs_data);
+    free(gbm_data);
+    free(index_data);
 
     uint32_t gba_size = embedded_gba_size;
     uint32_t padded_gba = (gba_size + 255) & ~255;
     uint32_t total_size = padded_gba + gbfs_size;
 
+    // Player with the archive offset filled in (older players scan for it)
+    uint8_t* gba_data = malloc(gba_size);
+    if (!gba_data) {
+        free(gbfs_data);
+        return 1;
+    }
+    memcpy(gba_data, embedded_gba_data, gba_size);
+    patch_gbfs_locator(gba_data, gba_size, padded_gba);
+
     FILE* out = fopen(output_path, "wb");
     if (!out) {
         fprintf(stderr, "Error: Cannot create output file: %s\n", output_path);
+        free(gba_data);
         free(gbfs_data);
         return 1;
     }
 
-    fwrite(embedded_gba_data, 1, gba_size, out);
+    fwrite(gba_data, 1, gba_size, out);
+    free(gba_data);
 
     uint8_t padding[256] = {0};
     uint32_t pad_size = padded_gba - gba_size;
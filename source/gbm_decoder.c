@@ -1,7 +1,12 @@
 #include "gbm_decoder.h"
 #include <string.h>
 
-#define ROW_BYTES (FRAME_WIDTH * 2)
+// Word-aligned kernels run in ARM mode so row copies become ldm/stm
+#ifdef GBM_HOST_BUILD
+#define ARM_CODE
+#else
+#define ARM_CODE __attribute__((target("arm")))
+#endif
 
 // XOR key for decoding flag_bytes (default to Gen1)
 static u16 xor_key = 0xD669;
@@ -16,9 +21,17 @@ void gbm_set_version(u8 version) {
     }
 }
 
-// Codebook offsets - place in IWRAM for fast access (256 bytes)
-// Use .iwram.rodata to avoid conflict with .iwram code section
-__attribute__((section(".iwram.rodata"))) static const s16 CODEBOOK_OFFSETS[] = {
+// Frame geometry, FRAME_WIDTH x FRAME_HEIGHT unless gbm_set_frame_size()
+// says otherwise. Frames are stored with a stride of their width.
+static int row_stride = FRAME_WIDTH;    // in u16 units
+static int mb_cols = GBM_MB_COLS;
+static int mb_rows = GBM_MB_ROWS;
+
+// Codebook offsets in bytes for a 240-pixel stride (rebuilt by
+// gbm_set_frame_size for other widths). Lives in IWRAM .data (512 bytes).
+// Index = (dy + 8) * 16 + (dx + 8): even indices have an even dx, so the
+// reference of any block at least 2 pixels wide is then word aligned.
+static s16 codebook_offsets[256] = {
     -3856, -3854, -3852, -3850, -3848, -3846, -3844, -3842,
     -3840, -3838, -3836, -3834, -3832, -3830, -3828, -3826,
     -3376, -3374, -3372, -3370, -3368, -3366, -3364, -3362,
@@ -65,8 +78,8 @@ static inline u16 read_u16_unaligned(const u8 *ptr) {
 }
 
 // Critical Path: next_bit
-// Placing in IWRAM
-static IWRAM_CODE int next_bit(DecodeContext *ctx) {
+// Inlined into the IWRAM walker so the bit state stays in registers
+static inline int next_bit(DecodeContext *ctx) {
     if (ctx->state == (1u << 31)) {
         u32 word = read_u32_unaligned(ctx->flag_ptr);
         ctx->flag_ptr += 4;
@@ -80,7 +93,7 @@ static IWRAM_CODE int next_bit(DecodeContext *ctx) {
 }
 
 // Read 2 bits at once - optimized for common decode patterns
-static IWRAM_CODE int next_2bits(DecodeContext *ctx) {
+static inline int next_2bits(DecodeContext *ctx) {
     u32 state = ctx->state;
 
     // Fast path: sentinel is in low 30 bits, we have at least 2 data bits
@@ -127,14 +140,13 @@ static inline u8 read_code(DecodeContext *ctx) {
 }
 
 // Block operations - Hot path
-// dst is always 4-byte aligned (block starts at 8x8 boundaries)
+// d points into the current frame, s into the reference frame
+// d is 4-byte aligned for every block at least 2 pixels wide
 // Use 32-bit writes to EWRAM for better throughput
 // Use pointer increment instead of recalculating offset each row
-#define ROW_STRIDE (ROW_BYTES >> 1)  // stride in u16 units (240)
 
-static IWRAM_CODE void copy_u32_block(DecodeContext *ctx, int dst_off, int ref_off, int rows, int words) {
-    u32 *d = (u32*)(ctx->dst + (dst_off >> 1));
-    const u16 *s = ctx->ref + (ref_off >> 1);
+static inline void copy_u32_block(u16 *dst, const u16 *s, int rows, int words) {
+    u32 *d = (u32*)dst;
 
     for (int r = 0; r < rows; r++) {
         const u16 *sp = s;
@@ -144,25 +156,24 @@ static IWRAM_CODE void copy_u32_block(DecodeContext *ctx, int dst_off, int ref_o
             d[i] = val;
             sp += 2;
         }
-        d = (u32*)((u16*)d + ROW_STRIDE);
-        s += ROW_STRIDE;
+        d = (u32*)((u16*)d + row_stride);
+        s += row_stride;
     }
 }
 
-static IWRAM_CODE void fill_u32_block(DecodeContext *ctx, int dst_off, int rows, int words, u16 color) {
+static inline void fill_u32_block(u16 *dst, int rows, int words, u16 color) {
     u32 color32 = color | ((u32)color << 16);
-    u32 *d = (u32*)(ctx->dst + (dst_off >> 1));
+    u32 *d = (u32*)dst;
     for (int r = 0; r < rows; r++) {
         for (int i = 0; i < words; i++) {
             d[i] = color32;
         }
-        d = (u32*)((u16*)d + ROW_STRIDE);
+        d = (u32*)((u16*)d + row_stride);
     }
 }
 
-static IWRAM_CODE void delta_u32_block(DecodeContext *ctx, int dst_off, int ref_off, int rows, int words, s16 delta) {
-    u32 *d = (u32*)(ctx->dst + (dst_off >> 1));
-    const u16 *s = ctx->ref + (ref_off >> 1);
+static inline void delta_u32_block(u16 *dst, const u16 *s, int rows, int words, s16 delta) {
+    u32 *d = (u32*)dst;
     // RGB555: bit15 is unused, can absorb carry from lower pixel
     // Pack delta into both halves, clear bit15/31 before add to prevent overflow propagation
     u32 delta32 = (u16)delta | ((u32)(u16)delta << 16);
@@ -175,604 +186,453 @@ static IWRAM_CODE void delta_u32_block(DecodeContext *ctx, int dst_off, int ref_
             d[i] = ((val & 0x7FFF7FFF) + delta32);
             sp += 2;
         }
-        d = (u32*)((u16*)d + ROW_STRIDE);
-        s += ROW_STRIDE;
+        d = (u32*)((u16*)d + row_stride);
+        s += row_stride;
     }
 }
 
-static IWRAM_CODE void copy_u16_block(DecodeContext *ctx, int dst_off, int ref_off, int rows, int halfwords) {
-    u16 *d = ctx->dst + (dst_off >> 1);
-    const u16 *s = ctx->ref + (ref_off >> 1);
+// Word-aligned reference: one 32-bit load per two pixels instead of two
+// halfword loads and a repack. Same results as the halfword versions.
+static inline void copy_u32_block_aligned(u16 *dst, const u16 *src, int rows, int words) {
+    u32 *d = (u32*)dst;
+    const u32 *s = (const u32*)src;
     for (int r = 0; r < rows; r++) {
-        for (int i = 0; i < halfwords; i++) {
+        for (int i = 0; i < words; i++) {
             d[i] = s[i];
         }
-        d += ROW_STRIDE;
-        s += ROW_STRIDE;
+        d += (row_stride >> 1);
+        s += (row_stride >> 1);
     }
 }
 
-static IWRAM_CODE void fill_u16_block(DecodeContext *ctx, int dst_off, int rows, int halfwords, u16 color) {
-    u16 *d = ctx->dst + (dst_off >> 1);
+static inline void delta_u32_block_aligned(u16 *dst, const u16 *src, int rows, int words, s16 delta) {
+    u32 *d = (u32*)dst;
+    const u32 *s = (const u32*)src;
+    u32 delta32 = (u16)delta | ((u32)(u16)delta << 16);
     for (int r = 0; r < rows; r++) {
-        for (int i = 0; i < halfwords; i++) {
-            d[i] = color;
+        for (int i = 0; i < words; i++) {
+            d[i] = ((s[i] & 0x7FFF7FFF) + delta32);
         }
-        d += ROW_STRIDE;
+        d += (row_stride >> 1);
+        s += (row_stride >> 1);
     }
 }
 
-static IWRAM_CODE void delta_u16_block(DecodeContext *ctx, int dst_off, int ref_off, int rows, int halfwords, s16 delta) {
-    u16 *d = ctx->dst + (dst_off >> 1);
-    const u16 *s = ctx->ref + (ref_off >> 1);
+static inline void copy_u16_block(u16 *d, const u16 *s, int rows, int halfwords) {
     for (int r = 0; r < rows; r++) {
         for (int i = 0; i < halfwords; i++) {
-            d[i] = s[i] + delta;
+            d[i] = s[i];
         }
-        d += ROW_STRIDE;
-        s += ROW_STRIDE;
+        d += row_stride;
+        s += row_stride;
     }
 }
 
-// Forward declarations
-static IWRAM_CODE void decode_block_8x4(DecodeContext *ctx);
-static IWRAM_CODE void decode_block_4x8(DecodeContext *ctx);
-static IWRAM_CODE void decode_block_4x4(DecodeContext *ctx);
-static IWRAM_CODE void decode_block_8x2(DecodeContext *ctx);
-static IWRAM_CODE void decode_block_2x8(DecodeContext *ctx);
-static IWRAM_CODE void decode_block_2x4(DecodeContext *ctx);
-static IWRAM_CODE void decode_block_4x2(DecodeContext *ctx);
-static IWRAM_CODE void decode_block_1x8(DecodeContext *ctx);
-static IWRAM_CODE void decode_block_8x1(DecodeContext *ctx);
-static IWRAM_CODE void decode_block_1x4(DecodeContext *ctx);
-static IWRAM_CODE void decode_block_2x2(DecodeContext *ctx);
-static IWRAM_CODE void decode_block_4x1(DecodeContext *ctx);
-static IWRAM_CODE void decode_block_1x2(DecodeContext *ctx);
-static IWRAM_CODE void decode_block_2x1(DecodeContext *ctx);
-
-
-// Functions
-static IWRAM_CODE void decode_block_8x8(DecodeContext *ctx) {
-    switch (next_2bits(ctx)) {
-    case 0: // 00: copy from same position
-        // copy_u32_block(ctx, ctx->block_offset, ctx->block_offset, 8, 4); // no-op: VRAM==BUF
-        break;
-    case 1: // 01: copy with codebook offset
-        {
-            u8 code = read_code(ctx);
-            copy_u32_block(ctx, ctx->block_offset, ctx->block_offset + CODEBOOK_OFFSETS[code], 8, 4);
-        }
-        break;
-    case 2: // 10: subdivide
-        if (next_bit(ctx) == 0) {
-            decode_block_8x4(ctx);
-            decode_block_8x4(ctx);
-        } else {
-            decode_block_4x8(ctx);
-            decode_block_4x8(ctx);
-        }
-        break;
-    case 3: // 11: delta or fill
-        if (next_bit(ctx) == 0) {
-            u8 code = read_code(ctx);
-            s16 color = to_signed16(read_palette_color(ctx));
-            delta_u32_block(ctx, ctx->block_offset, ctx->block_offset + CODEBOOK_OFFSETS[code], 8, 4, color);
-        } else {
-            u16 color = read_palette_color(ctx);
-            fill_u32_block(ctx, ctx->block_offset, 8, 4, color);
+static inline void fill_u16_block(u16 *d, int rows, int halfwords, u16 color) {
+    for (int r = 0; r < rows; r++) {
+        for (int i = 0; i < halfwords; i++) {
+            d[i] = color;
         }
-        break;
+        d += row_stride;
     }
 }
 
-static IWRAM_CODE void decode_block_8x4(DecodeContext *ctx) {
-    switch (next_2bits(ctx)) {
-    case 0: // 00: copy from same position
-        // copy_u32_block(ctx, ctx->block_offset, ctx->block_offset, 4, 4); // no-op: VRAM==BUF
-        ctx->block_offset += 0x780;
-        break;
-    case 1: // 01: copy with codebook offset
-        {
-            u8 code = read_code(ctx);
-            copy_u32_block(ctx, ctx->block_offset, ctx->block_offset + CODEBOOK_OFFSETS[code], 4, 4);
-        }
-        ctx->block_offset += 0x780;
-        break;
-    case 2: // 10: subdivide
-        if (next_bit(ctx) == 0) {
-            decode_block_8x2(ctx);
-            decode_block_8x2(ctx);
-        } else {
-            decode_block_4x4(ctx);
-            decode_block_4x4(ctx);
-            ctx->block_offset += 0x770;
-        }
-        break;
-    case 3: // 11: delta or fill
-        if (next_bit(ctx) == 0) {
-            u8 code = read_code(ctx);
-            s16 color = to_signed16(read_palette_color(ctx));
-            delta_u32_block(ctx, ctx->block_offset, ctx->block_offset + CODEBOOK_OFFSETS[code], 4, 4, color);
-        } else {
-            u16 color = read_palette_color(ctx);
-            fill_u32_block(ctx, ctx->block_offset, 4, 4, color);
+static inline void delta_u16_block(u16 *d, const u16 *s, int rows, int halfwords, s16 delta) {
+    for (int r = 0; r < rows; r++) {
+        for (int i = 0; i < halfwords; i++) {
+            d[i] = s[i] + delta;
         }
-        ctx->block_offset += 0x780;
-        break;
+        d += row_stride;
+        s += row_stride;
     }
 }
 
-static IWRAM_CODE void decode_block_4x8(DecodeContext *ctx) {
-    switch (next_2bits(ctx)) {
-    case 0: // 00: copy from same position
-        // copy_u32_block(ctx, ctx->block_offset, ctx->block_offset, 8, 2); // no-op: VRAM==BUF
-        ctx->block_offset += 8;
-        break;
-    case 1: // 01: copy with codebook offset
-        {
-            u8 code = read_code(ctx);
-            copy_u32_block(ctx, ctx->block_offset, ctx->block_offset + CODEBOOK_OFFSETS[code], 8, 2);
-        }
-        ctx->block_offset += 8;
-        break;
-    case 2: // 10: subdivide
-        if (next_bit(ctx) == 0) {
-            decode_block_4x4(ctx);
-            ctx->block_offset += 0x778;
-            decode_block_4x4(ctx);
-            ctx->block_offset -= 0x780;
-        } else {
-            decode_block_2x8(ctx);
-            decode_block_2x8(ctx);
-        }
-        break;
-    case 3: // 11: delta or fill
-        if (next_bit(ctx) == 0) {
-            u8 code = read_code(ctx);
-            s16 color = to_signed16(read_palette_color(ctx));
-            delta_u32_block(ctx, ctx->block_offset, ctx->block_offset + CODEBOOK_OFFSETS[code], 8, 2, color);
-        } else {
-            u16 color = read_palette_color(ctx);
-            fill_u32_block(ctx, ctx->block_offset, 8, 2, color);
-        }
-        ctx->block_offset += 8;
-        break;
+// Block shapes of the quadtree, WxH in pixels.
+// A split either stacks two halves (rows) or places them side by side
+// (columns); 1xN blocks can only split rows and Nx1 only columns, so those
+// carry no selector bit. 1x2 and 2x1 are leaves with their own opcode map.
+enum {
+    SHAPE_8x8, SHAPE_8x4, SHAPE_4x8, SHAPE_4x4, SHAPE_8x2,
+    SHAPE_2x8, SHAPE_2x4, SHAPE_4x2, SHAPE_1x8, SHAPE_8x1,
+    SHAPE_1x4, SHAPE_2x2, SHAPE_4x1, SHAPE_1x2, SHAPE_2x1,
+    SHAPE_NONE = 0xFF
+};
+
+#define SHAPE_NARROW    0x01    // 1 pixel wide
+#define SHAPE_LEAF      0x02    // 1x2 / 2x1 opcode map, no subdivision
+#define SHAPE_ONLY_ROWS 0x04    // split without selector bit, rows only
+#define SHAPE_ONLY_COLS 0x08    // split without selector bit, columns only
+
+#define SPLIT_ROWS 0
+#define SPLIT_COLS 1
+
+typedef struct {
+    u8 flags;
+    u8 child[2];    // Child shape for SPLIT_ROWS / SPLIT_COLS
+    u16 step[2];    // Pixel offset of the second child for SPLIT_ROWS / SPLIT_COLS
+} ShapeInfo;
+
+// Per-shape kernels: the generic block operations with constant sizes, so
+// every inner loop is fully specialized (as the old per-shape functions were).
+// Leaves (1x2, 2x1) have no fill.
+#define COPY_DELTA_KERNELS(name, rows, words) \
+    static IWRAM_CODE ARM_CODE void copy_##name##_aligned(u16 *d, const u16 *s) { \
+        copy_u32_block_aligned(d, s, rows, words); \
+    } \
+    static IWRAM_CODE void copy_##name(u16 *d, const u16 *s) { \
+        copy_u32_block(d, s, rows, words); \
+    } \
+    static IWRAM_CODE ARM_CODE void delta_##name##_aligned(u16 *d, const u16 *s, s16 delta) { \
+        delta_u32_block_aligned(d, s, rows, words, delta); \
+    } \
+    static IWRAM_CODE void delta_##name(u16 *d, const u16 *s, s16 delta) { \
+        delta_u32_block(d, s, rows, words, delta); \
     }
-}
 
-static IWRAM_CODE void decode_block_2x8(DecodeContext *ctx) {
-    switch (next_2bits(ctx)) {
-    case 0: // 00: copy from same position
-        // copy_u32_block(ctx, ctx->block_offset, ctx->block_offset, 8, 1); // no-op: VRAM==BUF
-        ctx->block_offset += 4;
-        break;
-    case 1: // 01: copy with codebook offset
-        {
-            u8 code = read_code(ctx);
-            copy_u32_block(ctx, ctx->block_offset, ctx->block_offset + CODEBOOK_OFFSETS[code], 8, 1);
-        }
-        ctx->block_offset += 4;
-        break;
-    case 2: // 10: subdivide
-        if (next_bit(ctx) == 0) {
-            decode_block_2x4(ctx);
-            ctx->block_offset += 0x77C;
-            decode_block_2x4(ctx);
-            ctx->block_offset -= 0x780;
-        } else {
-            decode_block_1x8(ctx);
-            decode_block_1x8(ctx);
-        }
-        break;
-    case 3: // 11: delta or fill
-        if (next_bit(ctx) == 0) {
-            u8 code = read_code(ctx);
-            s16 color = to_signed16(read_palette_color(ctx));
-            delta_u32_block(ctx, ctx->block_offset, ctx->block_offset + CODEBOOK_OFFSETS[code], 8, 1, color);
-        } else {
-            u16 color = read_palette_color(ctx);
-            fill_u32_block(ctx, ctx->block_offset, 8, 1, color);
-        }
-        ctx->block_offset += 4;
-        break;
+#define SHAPE_KERNELS(name, rows, words) \
+    COPY_DELTA_KERNELS(name, rows, words) \
+    static IWRAM_CODE void fill_##name(u16 *d, u16 color) { \
+        fill_u32_block(d, rows, words, color); \
     }
-}
 
-static IWRAM_CODE void decode_block_1x8(DecodeContext *ctx) {
-    switch (next_2bits(ctx)) {
-    case 0: // 00: copy from same position
-        // copy_u16_block(ctx, ctx->block_offset, ctx->block_offset, 8, 1); // no-op: VRAM==BUF
-        ctx->block_offset += 2;
-        break;
-    case 1: // 01: copy with codebook offset
-        {
-            u8 code = read_code(ctx);
-            copy_u16_block(ctx, ctx->block_offset, ctx->block_offset + CODEBOOK_OFFSETS[code], 8, 1);
-        }
-        ctx->block_offset += 2;
-        break;
-    case 2: // 10: subdivide (only vertical split for 1xN)
-        decode_block_1x4(ctx);
-        ctx->block_offset += 0x77E;
-        decode_block_1x4(ctx);
-        ctx->block_offset -= 0x780;
-        break;
-    case 3: // 11: delta or fill
-        if (next_bit(ctx) == 0) {
-            u8 code = read_code(ctx);
-            s16 color = to_signed16(read_palette_color(ctx));
-            delta_u16_block(ctx, ctx->block_offset, ctx->block_offset + CODEBOOK_OFFSETS[code], 8, 1, color);
-        } else {
-            u16 color = read_palette_color(ctx);
-            fill_u16_block(ctx, ctx->block_offset, 8, 1, color);
-        }
-        ctx->block_offset += 2;
-        break;
+// 1 pixel wide: halfword accesses whatever the alignment, so the
+// "aligned" kernels are the same code
+#define COPY_DELTA_KERNELS_NARROW(name, rows) \
+    static IWRAM_CODE void copy_##name(u16 *d, const u16 *s) { \
+        copy_u16_block(d, s, rows, 1); \
+    } \
+    static IWRAM_CODE void copy_##name##_aligned(u16 *d, const u16 *s) { \
+        copy_u16_block(d, s, rows, 1); \
+    } \
+    static IWRAM_CODE void delta_##name(u16 *d, const u16 *s, s16 delta) { \
+        delta_u16_block(d, s, rows, 1, delta); \
+    } \
+    static IWRAM_CODE void delta_##name##_aligned(u16 *d, const u16 *s, s16 delta) { \
+        delta_u16_block(d, s, rows, 1, delta); \
     }
-}
 
-static IWRAM_CODE void decode_block_4x4(DecodeContext *ctx) {
-    switch (next_2bits(ctx)) {
-    case 0: // 00: copy from same position
-        // copy_u32_block(ctx, ctx->block_offset, ctx->block_offset, 4, 2); // no-op: VRAM==BUF
-        ctx->block_offset += 8;
-        break;
-    case 1: // 01: copy with codebook offset
-        {
-            u8 code = read_code(ctx);
-            copy_u32_block(ctx, ctx->block_offset, ctx->block_offset + CODEBOOK_OFFSETS[code], 4, 2);
-        }
-        ctx->block_offset += 8;
-        break;
-    case 2: // 10: subdivide
-        if (next_bit(ctx) == 0) {
-            decode_block_4x2(ctx);
-            ctx->block_offset += 0x3B8;
-            decode_block_4x2(ctx);
-            ctx->block_offset -= 0x3C0;
-        } else {
-            decode_block_2x4(ctx);
-            decode_block_2x4(ctx);
-        }
-        break;
-    case 3: // 11: delta or fill
-        if (next_bit(ctx) == 0) {
-            u8 code = read_code(ctx);
-            s16 color = to_signed16(read_palette_color(ctx));
-            delta_u32_block(ctx, ctx->block_offset, ctx->block_offset + CODEBOOK_OFFSETS[code], 4, 2, color);
-        } else {
-            u16 color = read_palette_color(ctx);
-            fill_u32_block(ctx, ctx->block_offset, 4, 2, color);
-        }
-        ctx->block_offset += 8;
-        break;
+#define SHAPE_KERNELS_NARROW(name, rows) \
+    COPY_DELTA_KERNELS_NARROW(name, rows) \
+    static IWRAM_CODE void fill_##name(u16 *d, u16 color) { \
+        fill_u16_block(d, rows, 1, color); \
     }
-}
 
-static IWRAM_CODE void decode_block_8x2(DecodeContext *ctx) {
-    switch (next_2bits(ctx)) {
-    case 0: // 00: copy from same position
-        // copy_u32_block(ctx, ctx->block_offset, ctx->block_offset, 2, 4); // no-op: VRAM==BUF
-        ctx->block_offset += 0x3C0;
+SHAPE_KERNELS(8x8, 8, 4)
+SHAPE_KERNELS(8x4, 4, 4)
+SHAPE_KERNELS(4x8, 8, 2)
+SHAPE_KERNELS(4x4, 4, 2)
+SHAPE_KERNELS(8x2, 2, 4)
+SHAPE_KERNELS(2x8, 8, 1)
+SHAPE_KERNELS(2x4, 4, 1)
+SHAPE_KERNELS(4x2, 2, 2)
+SHAPE_KERNELS_NARROW(1x8, 8)
+SHAPE_KERNELS(8x1, 1, 4)
+SHAPE_KERNELS_NARROW(1x4, 4)
+SHAPE_KERNELS(2x2, 2, 1)
+SHAPE_KERNELS(4x1, 1, 2)
+COPY_DELTA_KERNELS_NARROW(1x2, 2)
+COPY_DELTA_KERNELS(2x1, 1, 1)
+
+#define SHAPE(w, h, flags, rows_child, cols_child) \
+    { (flags), { (rows_child), (cols_child) }, { (h) / 2 * FRAME_WIDTH, (w) / 2 } }
+
+// Row-split steps assume FRAME_WIDTH and are rescaled by gbm_set_frame_size
+static ShapeInfo shapes[] = {
+    [SHAPE_8x8] = SHAPE(8, 8, 0, SHAPE_8x4, SHAPE_4x8),
+    [SHAPE_8x4] = SHAPE(8, 4, 0, SHAPE_8x2, SHAPE_4x4),
+    [SHAPE_4x8] = SHAPE(4, 8, 0, SHAPE_4x4, SHAPE_2x8),
+    [SHAPE_4x4] = SHAPE(4, 4, 0, SHAPE_4x2, SHAPE_2x4),
+    [SHAPE_8x2] = SHAPE(8, 2, 0, SHAPE_8x1, SHAPE_4x2),
+    [SHAPE_2x8] = SHAPE(2, 8, 0, SHAPE_2x4, SHAPE_1x8),
+    [SHAPE_2x4] = SHAPE(2, 4, 0, SHAPE_2x2, SHAPE_1x4),
+    [SHAPE_4x2] = SHAPE(4, 2, 0, SHAPE_4x1, SHAPE_2x2),
+    [SHAPE_1x8] = SHAPE(1, 8, SHAPE_NARROW | SHAPE_ONLY_ROWS, SHAPE_1x4, SHAPE_NONE),
+    [SHAPE_8x1] = SHAPE(8, 1, SHAPE_ONLY_COLS, SHAPE_NONE, SHAPE_4x1),
+    [SHAPE_1x4] = SHAPE(1, 4, SHAPE_NARROW | SHAPE_ONLY_ROWS, SHAPE_1x2, SHAPE_NONE),
+    [SHAPE_2x2] = SHAPE(2, 2, 0, SHAPE_2x1, SHAPE_1x2),
+    [SHAPE_4x1] = SHAPE(4, 1, SHAPE_ONLY_COLS, SHAPE_NONE, SHAPE_2x1),
+    [SHAPE_1x2] = SHAPE(1, 2, SHAPE_NARROW | SHAPE_LEAF, SHAPE_NONE, SHAPE_NONE),
+    [SHAPE_2x1] = SHAPE(2, 1, SHAPE_LEAF, SHAPE_NONE, SHAPE_NONE),
+};
+
+// Kernel dispatch: a switch on the shape with a direct call per case, so
+// the walker branches through one jump table instead of loading a kernel
+// pointer. odd is the codebook index parity: 0 = word-aligned reference.
+#define COPY_CASE(name) \
+    case SHAPE_##name: \
+        if (odd) copy_##name(d, s); else copy_##name##_aligned(d, s); \
         break;
-    case 1: // 01: copy with codebook offset
-        {
-            u8 code = read_code(ctx);
-            copy_u32_block(ctx, ctx->block_offset, ctx->block_offset + CODEBOOK_OFFSETS[code], 2, 4);
-        }
-        ctx->block_offset += 0x3C0;
+#define DELTA_CASE(name) \
+    case SHAPE_##name: \
+        if (odd) delta_##name(d, s, delta); else delta_##name##_aligned(d, s, delta); \
         break;
-    case 2: // 10: subdivide
-        if (next_bit(ctx) == 0) {
-            decode_block_8x1(ctx);
-            decode_block_8x1(ctx);
-        } else {
-            decode_block_4x2(ctx);
-            decode_block_4x2(ctx);
-            ctx->block_offset += 0x3B0;
-        }
-        break;
-    case 3: // 11: delta or fill
-        if (next_bit(ctx) == 0) {
-            u8 code = read_code(ctx);
-            s16 color = to_signed16(read_palette_color(ctx));
-            delta_u32_block(ctx, ctx->block_offset, ctx->block_offset + CODEBOOK_OFFSETS[code], 2, 4, color);
-        } else {
-            u16 color = read_palette_color(ctx);
-            fill_u32_block(ctx, ctx->block_offset, 2, 4, color);
-        }
-        ctx->block_offset += 0x3C0;
+#define FILL_CASE(name) \
+    case SHAPE_##name: \
+        fill_##name(d, color); \
         break;
+
+#define FOR_EACH_SPLIT_SHAPE(X) \
+    X(8x8) X(8x4) X(4x8) X(4x4) X(8x2) X(2x8) X(2x4) \
+    X(4x2) X(1x8) X(8x1) X(1x4) X(2x2) X(4x1)
+
+static inline void copy_shape(u32 shape, u16 *d, const u16 *s, u32 odd) {
+    switch (shape) {
+    FOR_EACH_SPLIT_SHAPE(COPY_CASE)
+    COPY_CASE(1x2)
+    COPY_CASE(2x1)
     }
 }
 
-static IWRAM_CODE void decode_block_2x4(DecodeContext *ctx) {
-    switch (next_2bits(ctx)) {
-    case 0: // 00: copy from same position
-        // copy_u32_block(ctx, ctx->block_offset, ctx->block_offset, 4, 1); // no-op: VRAM==BUF
-        ctx->block_offset += 4;
-        break;
-    case 1: // 01: copy with codebook offset
-        {
-            u8 code = read_code(ctx);
-            copy_u32_block(ctx, ctx->block_offset, ctx->block_offset + CODEBOOK_OFFSETS[code], 4, 1);
-        }
-        ctx->block_offset += 4;
-        break;
-    case 2: // 10: subdivide
-        if (next_bit(ctx) == 0) {
-            decode_block_2x2(ctx);
-            ctx->block_offset += 0x3BC;
-            decode_block_2x2(ctx);
-            ctx->block_offset -= 0x3C0;
-        } else {
-            decode_block_1x4(ctx);
-            decode_block_1x4(ctx);
-        }
-        break;
-    case 3: // 11: delta or fill
-        if (next_bit(ctx) == 0) {
-            u8 code = read_code(ctx);
-            s16 color = to_signed16(read_palette_color(ctx));
-            delta_u32_block(ctx, ctx->block_offset, ctx->block_offset + CODEBOOK_OFFSETS[code], 4, 1, color);
-        } else {
-            u16 color = read_palette_color(ctx);
-            fill_u32_block(ctx, ctx->block_offset, 4, 1, color);
-        }
-        ctx->block_offset += 4;
-        break;
+static inline void delta_shape(u32 shape, u16 *d, const u16 *s, u32 odd, s16 delta) {
+    switch (shape) {
+    FOR_EACH_SPLIT_SHAPE(DELTA_CASE)
+    DELTA_CASE(1x2)
+    DELTA_CASE(2x1)
     }
 }
 
-static IWRAM_CODE void decode_block_4x2(DecodeContext *ctx) {
-    switch (next_2bits(ctx)) {
-    case 0: // 00: copy from same position
-        // copy_u32_block(ctx, ctx->block_offset, ctx->block_offset, 2, 2); // no-op: VRAM==BUF
-        ctx->block_offset += 8;
-        break;
-    case 1: // 01: copy with codebook offset
-        {
-            u8 code = read_code(ctx);
-            copy_u32_block(ctx, ctx->block_offset, ctx->block_offset + CODEBOOK_OFFSETS[code], 2, 2);
-        }
-        ctx->block_offset += 8;
-        break;
-    case 2: // 10: subdivide
-        if (next_bit(ctx) == 0) {
-            decode_block_4x1(ctx);
-            ctx->block_offset += 0x1D8;
-            decode_block_4x1(ctx);
-            ctx->block_offset -= 0x1E0;
-        } else {
-            decode_block_2x2(ctx);
-            decode_block_2x2(ctx);
-        }
-        break;
-    case 3: // 11: delta or fill
-        if (next_bit(ctx) == 0) {
-            u8 code = read_code(ctx);
-            s16 color = to_signed16(read_palette_color(ctx));
-            delta_u32_block(ctx, ctx->block_offset, ctx->block_offset + CODEBOOK_OFFSETS[code], 2, 2, color);
-        } else {
-            u16 color = read_palette_color(ctx);
-            fill_u32_block(ctx, ctx->block_offset, 2, 2, color);
-        }
-        ctx->block_offset += 8;
-        break;
+// Leaves have no fill kernel: their 11 opcode writes two pixels itself
+static inline void fill_shape(u32 shape, u16 *d, u16 color) {
+    switch (shape) {
+    FOR_EACH_SPLIT_SHAPE(FILL_CASE)
     }
 }
 
-static IWRAM_CODE void decode_block_8x1(DecodeContext *ctx) {
-    switch (next_2bits(ctx)) {
-    case 0: // 00: copy from same position
-        // copy_u32_block(ctx, ctx->block_offset, ctx->block_offset, 1, 4); // no-op: VRAM==BUF
-        ctx->block_offset += 0x1E0;
-        break;
-    case 1: // 01: copy with codebook offset
-        {
-            u8 code = read_code(ctx);
-            copy_u32_block(ctx, ctx->block_offset, ctx->block_offset + CODEBOOK_OFFSETS[code], 1, 4);
-        }
-        ctx->block_offset += 0x1E0;
-        break;
-    case 2: // 10: subdivide (only horizontal split for Nx1)
-        decode_block_4x1(ctx);
-        decode_block_4x1(ctx);
-        ctx->block_offset += 0x1D0;
-        break;
-    case 3: // 11: delta or fill
-        if (next_bit(ctx) == 0) {
-            u8 code = read_code(ctx);
-            s16 color = to_signed16(read_palette_color(ctx));
-            delta_u32_block(ctx, ctx->block_offset, ctx->block_offset + CODEBOOK_OFFSETS[code], 1, 4, color);
-        } else {
-            u16 color = read_palette_color(ctx);
-            fill_u32_block(ctx, ctx->block_offset, 1, 4, color);
-        }
-        ctx->block_offset += 0x1E0;
-        break;
+void gbm_get_frame_size(const u8 *header, u16 *width, u16 *height) {
+    const u8 *tag = header + GBM_SIZE_TAG_OFFSET;
+    if (tag[0] == 'S' && tag[1] == 'I' && tag[2] == 'Z' && tag[3] == 'E') {
+        *width = tag[4] | (tag[5] << 8);
+        *height = tag[6] | (tag[7] << 8);
+    } else {
+        *width = FRAME_WIDTH;
+        *height = FRAME_HEIGHT;
     }
 }
 
-static IWRAM_CODE void decode_block_1x4(DecodeContext *ctx) {
-    switch (next_2bits(ctx)) {
-    case 0: // 00: copy from same position
-        // copy_u16_block(ctx, ctx->block_offset, ctx->block_offset, 4, 1); // no-op: VRAM==BUF
-        ctx->block_offset += 2;
-        break;
-    case 1: // 01: copy with codebook offset
-        {
-            u8 code = read_code(ctx);
-            copy_u16_block(ctx, ctx->block_offset, ctx->block_offset + CODEBOOK_OFFSETS[code], 4, 1);
-        }
-        ctx->block_offset += 2;
-        break;
-    case 2: // 10: subdivide (only vertical split for 1xN)
-        decode_block_1x2(ctx);
-        ctx->block_offset += 0x3BE;
-        decode_block_1x2(ctx);
-        ctx->block_offset -= 0x3C0;
-        break;
-    case 3: // 11: delta or fill
-        if (next_bit(ctx) == 0) {
-            u8 code = read_code(ctx);
-            s16 color = to_signed16(read_palette_color(ctx));
-            delta_u16_block(ctx, ctx->block_offset, ctx->block_offset + CODEBOOK_OFFSETS[code], 4, 1, color);
-        } else {
-            u16 color = read_palette_color(ctx);
-            fill_u16_block(ctx, ctx->block_offset, 4, 1, color);
-        }
-        ctx->block_offset += 2;
-        break;
+int gbm_set_frame_size(u16 width, u16 height) {
+    if (width == 0 || height == 0 || (width & 7) || (height & 7) ||
+        width > FRAME_WIDTH || height > FRAME_HEIGHT) {
+        return 0;
     }
-}
 
-static IWRAM_CODE void decode_block_2x2(DecodeContext *ctx) {
-    switch (next_2bits(ctx)) {
-    case 0: // 00: copy from same position
-        // copy_u32_block(ctx, ctx->block_offset, ctx->block_offset, 2, 1); // no-op: VRAM==BUF
-        ctx->block_offset += 4;
-        break;
-    case 1: // 01: copy with codebook offset
-        {
-            u8 code = read_code(ctx);
-            copy_u32_block(ctx, ctx->block_offset, ctx->block_offset + CODEBOOK_OFFSETS[code], 2, 1);
-        }
-        ctx->block_offset += 4;
-        break;
-    case 2: // 10: subdivide
-        if (next_bit(ctx) == 0) {
-            decode_block_2x1(ctx);
-            ctx->block_offset += 0x1DC;
-            decode_block_2x1(ctx);
-            ctx->block_offset -= 0x1E0;
-        } else {
-            decode_block_1x2(ctx);
-            decode_block_1x2(ctx);
-        }
-        break;
-    case 3: // 11: delta or fill
-        if (next_bit(ctx) == 0) {
-            u8 code = read_code(ctx);
-            s16 color = to_signed16(read_palette_color(ctx));
-            delta_u32_block(ctx, ctx->block_offset, ctx->block_offset + CODEBOOK_OFFSETS[code], 2, 1, color);
-        } else {
-            u16 color = read_palette_color(ctx);
-            fill_u32_block(ctx, ctx->block_offset, 2, 1, color);
-        }
-        ctx->block_offset += 4;
-        break;
+    // Row-split steps are a whole number of rows at the old stride
+    for (u32 i = 0; i < sizeof(shapes) / sizeof(shapes[0]); i++) {
+        shapes[i].step[SPLIT_ROWS] = shapes[i].step[SPLIT_ROWS] / row_stride * width;
+    }
+    for (int i = 0; i < 256; i++) {
+        int dy = (i >> 4) - 8;
+        int dx = (i & 15) - 8;
+        codebook_offsets[i] = (dy * width + dx) * 2;
     }
+
+    row_stride = width;
+    mb_cols = width / 8;
+    mb_rows = height / 8;
+    return 1;
 }
 
-static IWRAM_CODE void decode_block_4x1(DecodeContext *ctx) {
-    switch (next_2bits(ctx)) {
-    case 0: // 00: copy from same position
-        // copy_u32_block(ctx, ctx->block_offset, ctx->block_offset, 1, 2); // no-op: VRAM==BUF
-        ctx->block_offset += 8;
-        break;
-    case 1: // 01: copy with codebook offset
-        {
-            u8 code = read_code(ctx);
-            copy_u32_block(ctx, ctx->block_offset, ctx->block_offset + CODEBOOK_OFFSETS[code], 1, 2);
-        }
-        ctx->block_offset += 8;
-        break;
-    case 2: // 10: subdivide (only horizontal split for Nx1)
-        decode_block_2x1(ctx);
-        decode_block_2x1(ctx);
-        break;
-    case 3: // 11: delta or fill
-        if (next_bit(ctx) == 0) {
-            u8 code = read_code(ctx);
-            s16 color = to_signed16(read_palette_color(ctx));
-            delta_u32_block(ctx, ctx->block_offset, ctx->block_offset + CODEBOOK_OFFSETS[code], 1, 2, color);
-        } else {
-            u16 color = read_palette_color(ctx);
-            fill_u32_block(ctx, ctx->block_offset, 1, 2, color);
-        }
-        ctx->block_offset += 8;
-        break;
+// Pending second children. Each split pushes one entry and the walk goes
+// five splits deep at most (8x8 -> 1x2/2x1), so 8 entries is plenty.
+#define WALK_STACK_SIZE 8
+
+typedef struct {
+    u8 shape;
+    int pos;        // Top-left pixel index in the frame
+} WalkEntry;
+
+// Decode one 8x8 macroblock at ctx->block_offset.
+// Walks the quadtree depth-first with an explicit stack: the first child of
+// a split is decoded next, the second is pushed. Bitstream order matches the
+// recursive decode_block_* functions this replaces. Stream state is worked on
+// in a local copy so it stays in registers for the whole macroblock.
+// prefill: dst does not hold ref's pixels here (bands, stale pages), so
+// the macroblock is copied from ref before a split or for a "00" skip.
+// Returns nonzero if any pixel of the macroblock was written.
+static IWRAM_CODE int decode_macroblock(DecodeContext *ctx, int prefill) {
+    DecodeContext c = *ctx;
+    u16 *dst = c.dst;
+    const u16 *ref = c.ref;
+    WalkEntry stack[WALK_STACK_SIZE];
+    int sp = 0;
+    u32 shape = SHAPE_8x8;
+    int pos = c.block_offset >> 1;  // In pixels
+    int written = 0;
+
+    for (;;) {
+        const ShapeInfo *s = &shapes[shape];
+
+        switch (next_2bits(&c)) {
+        case 0: // 00: copy from same position - no-op: VRAM==BUF
+            if (prefill) {
+                copy_8x8_aligned(dst + pos, ref + pos);
+                prefill = 0;
+            }
+            break;
+        case 1: // 01: copy with codebook offset
+            {
+                u8 code = read_code(&c);
+                copy_shape(shape, dst + pos, ref + pos + (codebook_offsets[code] >> 1), code & 1);
+                written = 1;
+            }
+            break;
+        case 2:
+            if (!(s->flags & SHAPE_LEAF)) {
+                // 10: subdivide
+                int dir;
+                if (prefill) {
+                    copy_8x8_aligned(dst + pos, ref + pos);
+                    prefill = 0;
+                }
+                if (s->flags & SHAPE_ONLY_ROWS) {
+                    dir = SPLIT_ROWS;
+                } else if (s->flags & SHAPE_ONLY_COLS) {
+                    dir = SPLIT_COLS;
+                } else {
+                    dir = next_bit(&c);
+                }
+                shape = s->child[dir];
+                stack[sp].shape = shape;
+                stack[sp].pos = pos + s->step[dir];
+                sp++;
+                continue;
+            }
+            // 10: delta (1x2 / 2x1)
+            {
+                u8 code = read_code(&c);
+                s16 color = to_signed16(read_palette_color(&c));
+                delta_shape(shape, dst + pos, ref + pos + (codebook_offsets[code] >> 1), code & 1, color);
+                written = 1;
+            }
+            break;
+        case 3:
+            if (!(s->flags & SHAPE_LEAF)) {
+                // 11: delta or fill
+                if (next_bit(&c) == 0) {
+                    u8 code = read_code(&c);
+                    s16 color = to_signed16(read_palette_color(&c));
+                    delta_shape(shape, dst + pos, ref + pos + (codebook_offsets[code] >> 1), code & 1, color);
+                } else {
+                    u16 color = read_palette_color(&c);
+                    fill_shape(shape, dst + pos, color);
+                }
+            } else {
+                // 11: fill (same or two colors) - top/bottom for 1x2, left/right for 2x1
+                u16 color0 = read_palette_color(&c);
+                u16 color1 = next_bit(&c) ? read_palette_color(&c) : color0;
+                dst[pos] = color0;
+                if (s->flags & SHAPE_NARROW) {
+                    dst[pos + row_stride] = color1;
+                } else {
+                    dst[pos + 1] = color1;
+                }
+            }
+            written = 1;
+            break;
+        }
+
+        if (sp == 0) {
+            break;
+        }
+        sp--;
+        shape = stack[sp].shape;
+        pos = stack[sp].pos;
     }
+
+    ctx->state = c.state;
+    ctx->flag_ptr = c.flag_ptr;
+    ctx->palette_ptr = c.palette_ptr;
+    ctx->payload_ptr = c.payload_ptr;
+    return written;
 }
 
-static IWRAM_CODE void decode_block_1x2(DecodeContext *ctx) {
-    switch (next_2bits(ctx)) {
-    case 0: // 00: copy from same position
-        // copy_u16_block(ctx, ctx->block_offset, ctx->block_offset, 2, 1); // no-op: VRAM==BUF
-        ctx->block_offset += 2;
-        break;
-    case 1: // 01: copy with codebook offset
-        {
-            u8 code = read_code(ctx);
-            copy_u16_block(ctx, ctx->block_offset, ctx->block_offset + CODEBOOK_OFFSETS[code], 2, 1);
-        }
-        ctx->block_offset += 2;
-        break;
-    case 2: // 10: delta
-        {
-            u8 code = read_code(ctx);
-            s16 color = to_signed16(read_palette_color(ctx));
-            delta_u16_block(ctx, ctx->block_offset, ctx->block_offset + CODEBOOK_OFFSETS[code], 2, 1, color);
-        }
-        ctx->block_offset += 2;
-        break;
-    case 3: // 11: fill (same or two colors)
-        if (next_bit(ctx) == 0) {
-            u16 color0 = read_palette_color(ctx);
-            fill_u16_block(ctx, ctx->block_offset, 2, 1, color0);
-        } else {
-            u16 color0 = read_palette_color(ctx);
-            u16 color1 = read_palette_color(ctx);
-            ctx->dst[ctx->block_offset >> 1] = color0;
-            ctx->dst[(ctx->block_offset + ROW_BYTES) >> 1] = color1;
+// Leading "00" pairs in a byte, MSB first (ARM7TDMI has no CLZ)
+__attribute__((section(".iwram.rodata"))) static const u8 LEADING_SKIPS[256] = {
+    4, 3, 3, 3, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+};
+
+// Count the unchanged macroblocks ("00" at 8x8) at the head of the flag
+// stream and consume their bits, up to `remaining` blocks.
+// Looks only at bits already buffered in ctx->state; with nothing buffered
+// a whole zero flag word skips 16 blocks without touching state.
+static inline u32 skip_unchanged_run(DecodeContext *ctx, u32 remaining) {
+    u32 state = ctx->state;
+
+    if (state == (1u << 31)) {
+        // 16 blocks left means at least 32 more flag bits, so the word exists
+        if (remaining < 16 || read_u32_unaligned(ctx->flag_ptr) != 0) {
+            return 0;
         }
-        ctx->block_offset += 2;
-        break;
+        ctx->flag_ptr += 4;
+        return 16;
+    }
+
+    // The sentinel bit stops the count at the end of the buffered data
+    u32 probe = state;
+    u32 run = 0;
+    while (!(probe >> 24)) {
+        run += 4;
+        probe <<= 8;
     }
+    run += LEADING_SKIPS[probe >> 24];
+
+    if (run > remaining) {
+        run = remaining;
+    }
+    ctx->state = state << (run * 2);
+    return run;
 }
 
-static IWRAM_CODE void decode_block_2x1(DecodeContext *ctx) {
-    switch (next_2bits(ctx)) {
-    case 0: // 00: copy from same position
-        // copy_u32_block(ctx, ctx->block_offset, ctx->block_offset, 1, 1); // no-op: VRAM==BUF
-        ctx->block_offset += 4;
-        break;
-    case 1: // 01: copy with codebook offset
-        {
-            u8 code = read_code(ctx);
-            copy_u32_block(ctx, ctx->block_offset, ctx->block_offset + CODEBOOK_OFFSETS[code], 1, 1);
-        }
-        ctx->block_offset += 4;
-        break;
-    case 2: // 10: delta
-        {
-            u8 code = read_code(ctx);
-            s16 color = to_signed16(read_palette_color(ctx));
-            delta_u32_block(ctx, ctx->block_offset, ctx->block_offset + CODEBOOK_OFFSETS[code], 1, 1, color);
-        }
-        ctx->block_offset += 4;
-        break;
-    case 3: // 11: fill (same or two colors)
-        if (next_bit(ctx) == 0) {
-            u16 color0 = read_palette_color(ctx);
-            // Fill 2 pixels width with same color
-            ctx->dst[ctx->block_offset >> 1] = color0;
-            ctx->dst[(ctx->block_offset >> 1) + 1] = color0;
-        } else {
-            u16 color0 = read_palette_color(ctx);
-            u16 color1 = read_palette_color(ctx);
-            ctx->dst[ctx->block_offset >> 1] = color0;
-            ctx->dst[(ctx->block_offset >> 1) + 1] = color1;
-        }
-        ctx->block_offset += 4;
-        break;
+// Where a frame is decoded to, for the gbm_decode_frame* variants
+typedef struct {
+    u16 *dst;               // Whole frame, unless bands is set
+    u16 *const *bands;      // Band mode: row y goes to bands[y & 1]
+    const u16 *ref;
+    const u32 *stale_rows;  // Macroblocks where dst does not hold ref (optional)
+    u32 *dirty_rows;        // Macroblocks written (optional)
+    GbmRowDone row_done;    // Called after each macroblock row (optional)
+} FrameTarget;
+
+// Bring the stale macroblocks of a skipped run up to date from ref.
+// The run starts at (x_block, y_block) and may cross rows.
+static IWRAM_CODE void refresh_skipped(const FrameTarget *t, int x_block, int y_block, u32 run) {
+    while (run > 0) {
+        u32 n = mb_cols - x_block;
+        if (n > run) {
+            n = run;
+        }
+        u32 mask = (t->stale_rows[y_block] >> x_block) & ((1u << n) - 1);
+        int pos = y_block * 8 * row_stride + x_block * 8;
+        while (mask) {
+            if (mask & 1) {
+                copy_8x8_aligned(t->dst + pos, t->ref + pos);
+            }
+            mask >>= 1;
+            pos += 8;
+        }
+        run -= n;
+        x_block = 0;
+        y_block++;
     }
 }
 
 // Also put the main decoder loop in IWRAM for good measure?
 // It calls many IWRAM functions, so it's less critical, but looping overhead is reduced.
-u32 IWRAM_CODE gbm_decode_frame(const u8 *data, u32 offset, u16 *dst, const u16 *ref) {
+static IWRAM_CODE u32 decode_frame(const u8 *data, u32 offset, const FrameTarget *t) {
     u16 frame_len = read_u16_unaligned(data + offset);
     u16 bit_enc = read_u16_unaligned(data + offset + 2);
     u16 palette_bytes = read_u16_unaligned(data + offset + 4);
@@ -795,20 +655,78 @@ u32 IWRAM_CODE gbm_decode_frame(const u8 *data, u32 offset, u16 *dst, const u16
     ctx.palette_end = data + pal_end;
     ctx.payload_ptr = data + pal_end;
     ctx.payload_end = data + next_offset;
-    
-    ctx.dst = dst;
+
+    u16 *dst = t->dst;
+    u16 *const *bands = t->bands;
+    const u32 *stale_rows = t->stale_rows;
+
     // If ref is null, use dst (intra prediction behavior)
-    ctx.ref = ref ? ref : dst;
-
-    // Decode loop
-    for (int y_block = 0; y_block < 20; y_block++) {
-        ctx.row_offset = y_block * 8 * ROW_BYTES;
-        ctx.block_offset = ctx.row_offset;
-        for (int x_block = 0; x_block < 30; x_block++) {
-            ctx.block_offset = ctx.row_offset + x_block * 8 * 2; // 2 bytes per pixel
-            decode_block_8x8(&ctx);
+    const u16 *ref = t->ref ? t->ref : dst;
+
+    // dst/ref point at the top-left of the current macroblock row, so
+    // block offsets are relative to the row in both band and frame mode
+    ctx.dst = bands ? bands[0] : dst;
+    ctx.ref = ref;
+
+    // Band macroblocks start empty; page macroblocks only where stale
+    u32 row_prefill = bands ? ~0u : (stale_rows ? stale_rows[0] : 0);
+
+    // Decode loop: macroblocks in raster order. Runs of unchanged blocks
+    // are skipped straight from the flag bits, across row boundaries.
+    u32 row_dirty = 0;
+    u32 remaining = mb_cols * mb_rows;
+    int x_block = 0;
+    int y_block = 0;
+    ctx.row_offset = 0;
+
+    while (remaining > 0) {
+        u32 run = skip_unchanged_run(&ctx, remaining);
+        if (run == 0) {
+            ctx.block_offset = x_block * 8 * 2; // 2 bytes per pixel
+            if (decode_macroblock(&ctx, (row_prefill >> x_block) & 1)) {
+                row_dirty |= 1u << x_block;
+            }
+            run = 1;
+        } else if (stale_rows) {
+            refresh_skipped(t, x_block, y_block, run);
+        }
+
+        remaining -= run;
+        x_block += run;
+        while (x_block >= mb_cols) {
+            x_block -= mb_cols;
+            if (t->dirty_rows) {
+                t->dirty_rows[y_block] = row_dirty;
+            }
+            if (t->row_done) {
+                t->row_done(y_block, row_dirty);
+            }
+            row_dirty = 0;
+            y_block++;
+            ctx.row_offset += 8 * 2 * row_stride;
+            ctx.dst = bands ? bands[y_block & 1] : dst + (ctx.row_offset >> 1);
+            ctx.ref = ref + (ctx.row_offset >> 1);
+            if (stale_rows && y_block < mb_rows) {
+                row_prefill = stale_rows[y_block];
+            }
         }
     }
 
     return next_offset;
 }
+
+u32 IWRAM_CODE gbm_decode_frame(const u8 *data, u32 offset, u16 *dst, const u16 *ref, u32 *dirty_rows) {
+    FrameTarget t = { dst, NULL, ref, NULL, dirty_rows, NULL };
+    return decode_frame(data, offset, &t);
+}
+
+u32 IWRAM_CODE gbm_decode_frame_banded(const u8 *data, u32 offset, u16 *const bands[2], const u16 *ref, GbmRowDone row_done) {
+    FrameTarget t = { NULL, bands, ref, NULL, NULL, row_done };
+    return decode_frame(data, offset, &t);
+}
+
+u32 IWRAM_CODE gbm_decode_frame_paged(const u8 *data, u32 offset, u16 *dst, const u16 *ref,
+                                      const u32 *stale_rows, u32 *dirty_rows) {
+    FrameTarget t = { dst, NULL, ref, stale_rows, dirty_rows, NULL };
+    return decode_frame(data, offset, &t);
+}
@@ -14,14 +14,22 @@
 #include <string.h>
 
 // IWRAM placement for performance-critical code
+// GBS_HOST_BUILD: compile natively against the shims in bench/ - no IWRAM sections
+#ifdef GBS_HOST_BUILD
+#define IWRAM_CODE
+#else
 #define IWRAM_CODE __attribute__((section(".iwram"), long_call))
+#endif
 
 // ============================================================================
 // Constants
 // ============================================================================
 
 #define GBA_MASTER_CLOCK    16777216
-#define GBS_HEADER_SIZE     0x200
+
+// Buffer latency extension: "BUFM", u16 milliseconds at this header offset,
+// written by the packager (see choose_buffer_samples)
+#define GBS_BUFFER_TAG_OFFSET   0x1F0
 
 #ifndef TIMER_CASCADE
 #define TIMER_CASCADE       0x0004
@@ -32,44 +40,70 @@
 #define SOUNDCNT_X_ENABLE   0x0080
 
 // Buffer configuration
-// AUDIO_BUFFER_SAMPLES controls the buffer swap frequency and interrupt rate.
+// The buffer length (state.info.buffer_samples) controls the buffer swap
+// frequency and interrupt rate. It is chosen per stream at gbs_audio_init,
+// from the sample rate and the latency asked for with gbs_audio_set_buffer_ms
+// or the header's BUFM tag (see choose_buffer_samples).
 //
 // Timer0 overflows at sample_rate, Timer1 cascades and counts Timer0 overflows.
-// When Timer1 counts AUDIO_BUFFER_SAMPLES overflows, it triggers IRQ to swap buffers.
+// When Timer1 counts buffer_samples overflows, it triggers IRQ to swap buffers.
+// The IRQ only repoints DMA to the next buffer of the ring; buffers are decoded
+// by gbs_audio_update() from the main loop (see Ring Buffer Producer).
 //
-// Swap frequency = sample_rate / AUDIO_BUFFER_SAMPLES
+// Swap frequency = sample_rate / buffer_samples
 // Examples at 22050Hz: 368->60Hz, 512->43Hz, 736->30Hz, 1024->21.5Hz, 1472->15Hz
 // Examples at 11025Hz: 368->30Hz, 512->21.5Hz, 736->15Hz, 1024->10.8Hz
 //
-// Larger buffer = fewer interrupts but higher latency and more memory usage.
-// Buffer memory = AUDIO_BUFFER_SAMPLES * 2 (double buffering) * channels bytes.
-// Source data per interrupt varies by mode:
+// Larger buffer = fewer interrupts but higher latency and more memory in use.
+// Buffer memory in use = buffer_samples * AUDIO_BUFFER_COUNT * channels bytes,
+// out of a pool sized for AUDIO_BUFFER_SAMPLES.
+// Source data per 1024 samples varies by mode:
 //   Mode 0 (stereo 4bit): 1 byte/sample -> 1024 bytes
 //   Mode 1 (mono 3bit):   3/8 byte/sample -> 384 bytes
 //   Mode 2 (mono 4bit):   0.5 byte/sample -> 512 bytes
 //   Mode 3/4 (mono 2bit): 0.25 byte/sample -> 256 bytes
+//   Mode 5/6 (8-bit PCM): 1 byte/sample per channel -> 1024 bytes per channel,
+//                         played by DMA straight from ROM (see map_buffer_pcm)
 //
-// Value should be divisible by 8 for Mode 1 compatibility (8 samples per 3 bytes).
+// Lengths are multiples of 16: DMA feeds the FIFO 16 bytes at a time, and
+// Mode 1 decodes 8 samples per 3 bytes.
+
+// Longest buffer: sizes the IWRAM pool, and the default length at 22050 Hz
+#ifndef AUDIO_BUFFER_SAMPLES
 #define AUDIO_BUFFER_SAMPLES    1024
-#define AUDIO_BUFFER_COUNT      2
+#endif
+#define AUDIO_BUFFER_MIN_SAMPLES    128
+
+// Ring of decoded buffers: one playing, up to AUDIO_BUFFER_COUNT - 1 queued.
+// Three gives the main loop about two buffers (93 ms at 22050 Hz, 46 ms at
+// 44100 Hz) of slack before the ring runs dry and the IRQ has to decode a
+// buffer itself.
+#define AUDIO_BUFFER_COUNT      3
+
+// GBS_BYTE_TABLES: decode 4-bit IMA ADPCM two samples and 2-bit ADPCM a
+// byte (four samples) per lookup in the ROM tables generated into
+// gbs_byte_tables.c; 0 decodes code by code
+#ifndef GBS_BYTE_TABLES
+#define GBS_BYTE_TABLES 1
+#endif
+
+// GBS_AUDIO_STATS: keep playback telemetry for gbs_audio_get_stats() and
+// gbs_audio_save_stats(). The Timer1 IRQ is timed with Timer2 + Timer3
+// cascaded as a free-running cycle counter, so a build with it on must
+// leave those timers alone. 0 compiles the counters and timing out.
+#ifndef GBS_AUDIO_STATS
+#define GBS_AUDIO_STATS 0
+#endif
+
+// Where gbs_audio_save_stats() writes its record in SRAM
+#ifndef GBS_STATS_SRAM_OFFSET
+#define GBS_STATS_SRAM_OFFSET   0
+#endif
 
 // ============================================================================
 // ADPCM Tables
 // ============================================================================
 
-// Standard IMA ADPCM step table (89 entries)
-__attribute__((section(".iwram.rodata"))) static const int16_t ima_step_table[89] = {
-    7, 8, 9, 10, 11, 12, 13, 14, 16, 17,
-    19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
-    50, 55, 60, 66, 73, 80, 88, 97, 107, 118,
-    130, 143, 157, 173, 190, 209, 230, 253, 279, 307,
-    337, 371, 408, 449, 494, 544, 598, 658, 724, 796,
-    876, 963, 1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066,
-    2272, 2499, 2749, 3024, 3327, 3660, 4026, 4428, 4871, 5358,
-    5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487, 12635, 13899,
-    15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767
-};
-
 // Standard IMA ADPCM index adjustment table (4-bit)
 __attribute__((section(".iwram.rodata"))) static const int8_t ima_index_table[16] = {
     -1, -1, -1, -1, 2, 4, 6, 8,
@@ -265,6 +299,203 @@ __attribute__((section(".iwram.rodata"))) static const int16_t ima_diff_table[89
       4095,   8191,  16383,  20479,  32767,  32767,  32767,  32767,  -4095,  -8191, -16383, -20479, -32767, -32767, -32767, -32767,
 };
 
+// 3-bit ADPCM diff table: 89 steps * 8 codes = 712 entries (2848 bytes)
+// Index = step_index * 8 + code, Value = signed diff to add to predictor:
+// step/4 + (code & 2 ? step : 0) + (code & 1 ? step/2 : 0), negated for code & 4.
+// Larger than int16 at the top steps, hence int32.
+__attribute__((section(".iwram.rodata"))) static const int32_t adpcm3_diff_table[89 * 8] = {
+    // step_index=0, step=7
+         1,      4,      8,     11,     -1,     -4,     -8,    -11,
+    // step_index=1, step=8
+         2,      6,     10,     14,     -2,     -6,    -10,    -14,
+    // step_index=2, step=9
+         2,      6,     11,     15,     -2,     -6,    -11,    -15,
+    // step_index=3, step=10
+         2,      7,     12,     17,     -2,     -7,    -12,    -17,
+    // step_index=4, step=11
+         2,      7,     13,     18,     -2,     -7,    -13,    -18,
+    // step_index=5, step=12
+         3,      9,     15,     21,     -3,     -9,    -15,    -21,
+    // step_index=6, step=13
+         3,      9,     16,     22,     -3,     -9,    -16,    -22,
+    // step_index=7, step=14
+         3,     10,     17,     24,     -3,    -10,    -17,    -24,
+    // step_index=8, step=16
+         4,     12,     20,     28,     -4,    -12,    -20,    -28,
+    // step_index=9, step=17
+         4,     12,     21,     29,     -4,    -12,    -21,    -29,
+    // step_index=10, step=19
+         4,     13,     23,     32,     -4,    -13,    -23,    -32,
+    // step_index=11, step=21
+         5,     15,     26,     36,     -5,    -15,    -26,    -36,
+    // step_index=12, step=23
+         5,     16,     28,     39,     -5,    -16,    -28,    -39,
+    // step_index=13, step=25
+         6,     18,     31,     43,     -6,    -18,    -31,    -43,
+    // step_index=14, step=28
+         7,     21,     35,     49,     -7,    -21,    -35,    -49,
+    // step_index=15, step=31
+         7,     22,     38,     53,     -7,    -22,    -38,    -53,
+    // step_index=16, step=34
+         8,     25,     42,     59,     -8,    -25,    -42,    -59,
+    // step_index=17, step=37
+         9,     27,     46,     64,     -9,    -27,    -46,    -64,
+    // step_index=18, step=41
+        10,     30,     51,     71,    -10,    -30,    -51,    -71,
+    // step_index=19, step=45
+        11,     33,     56,     78,    -11,    -33,    -56,    -78,
+    // step_index=20, step=50
+        12,     37,     62,     87,    -12,    -37,    -62,    -87,
+    // step_index=21, step=55
+        13,     40,     68,     95,    -13,    -40,    -68,    -95,
+    // step_index=22, step=60
+        15,     45,     75,    105,    -15,    -45,    -75,   -105,
+    // step_index=23, step=66
+        16,     49,     82,    115,    -16,    -49,    -82,   -115,
+    // step_index=24, step=73
+        18,     54,     91,    127,    -18,    -54,    -91,   -127,
+    // step_index=25, step=80
+        20,     60,    100,    140,    -20,    -60,   -100,   -140,
+    // step_index=26, step=88
+        22,     66,    110,    154,    -22,    -66,   -110,   -154,
+    // step_index=27, step=97
+        24,     72,    121,    169,    -24,    -72,   -121,   -169,
+    // step_index=28, step=107
+        26,     79,    133,    186,    -26,    -79,   -133,   -186,
+    // step_index=29, step=118
+        29,     88,    147,    206,    -29,    -88,   -147,   -206,
+    // step_index=30, step=130
+        32,     97,    162,    227,    -32,    -97,   -162,   -227,
+    // step_index=31, step=143
+        35,    106,    178,    249,    -35,   -106,   -178,   -249,
+    // step_index=32, step=157
+        39,    117,    196,    274,    -39,   -117,   -196,   -274,
+    // step_index=33, step=173
+        43,    129,    216,    302,    -43,   -129,   -216,   -302,
+    // step_index=34, step=190
+        47,    142,    237,    332,    -47,   -142,   -237,   -332,
+    // step_index=35, step=209
+        52,    156,    261,    365,    -52,   -156,   -261,   -365,
+    // step_index=36, step=230
+        57,    172,    287,    402,    -57,   -172,   -287,   -402,
+    // step_index=37, step=253
+        63,    189,    316,    442,    -63,   -189,   -316,   -442,
+    // step_index=38, step=279
+        69,    208,    348,    487,    -69,   -208,   -348,   -487,
+    // step_index=39, step=307
+        76,    229,    383,    536,    -76,   -229,   -383,   -536,
+    // step_index=40, step=337
+        84,    252,    421,    589,    -84,   -252,   -421,   -589,
+    // step_index=41, step=371
+        92,    277,    463,    648,    -92,   -277,   -463,   -648,
+    // step_index=42, step=408
+       102,    306,    510,    714,   -102,   -306,   -510,   -714,
+    // step_index=43, step=449
+       112,    336,    561,    785,   -112,   -336,   -561,   -785,
+    // step_index=44, step=494
+       123,    370,    617,    864,   -123,   -370,   -617,   -864,
+    // step_index=45, step=544
+       136,    408,    680,    952,   -136,   -408,   -680,   -952,
+    // step_index=46, step=598
+       149,    448,    747,   1046,   -149,   -448,   -747,  -1046,
+    // step_index=47, step=658
+       164,    493,    822,   1151,   -164,   -493,   -822,  -1151,
+    // step_index=48, step=724
+       181,    543,    905,   1267,   -181,   -543,   -905,  -1267,
+    // step_index=49, step=796
+       199,    597,    995,   1393,   -199,   -597,   -995,  -1393,
+    // step_index=50, step=876
+       219,    657,   1095,   1533,   -219,   -657,  -1095,  -1533,
+    // step_index=51, step=963
+       240,    721,   1203,   1684,   -240,   -721,  -1203,  -1684,
+    // step_index=52, step=1060
+       265,    795,   1325,   1855,   -265,   -795,  -1325,  -1855,
+    // step_index=53, step=1166
+       291,    874,   1457,   2040,   -291,   -874,  -1457,  -2040,
+    // step_index=54, step=1282
+       320,    961,   1602,   2243,   -320,   -961,  -1602,  -2243,
+    // step_index=55, step=1411
+       352,   1057,   1763,   2468,   -352,  -1057,  -1763,  -2468,
+    // step_index=56, step=1552
+       388,   1164,   1940,   2716,   -388,  -1164,  -1940,  -2716,
+    // step_index=57, step=1707
+       426,   1279,   2133,   2986,   -426,  -1279,  -2133,  -2986,
+    // step_index=58, step=1878
+       469,   1408,   2347,   3286,   -469,  -1408,  -2347,  -3286,
+    // step_index=59, step=2066
+       516,   1549,   2582,   3615,   -516,  -1549,  -2582,  -3615,
+    // step_index=60, step=2272
+       568,   1704,   2840,   3976,   -568,  -1704,  -2840,  -3976,
+    // step_index=61, step=2499
+       624,   1873,   3123,   4372,   -624,  -1873,  -3123,  -4372,
+    // step_index=62, step=2749
+       687,   2061,   3436,   4810,   -687,  -2061,  -3436,  -4810,
+    // step_index=63, step=3024
+       756,   2268,   3780,   5292,   -756,  -2268,  -3780,  -5292,
+    // step_index=64, step=3327
+       831,   2494,   4158,   5821,   -831,  -2494,  -4158,  -5821,
+    // step_index=65, step=3660
+       915,   2745,   4575,   6405,   -915,  -2745,  -4575,  -6405,
+    // step_index=66, step=4026
+      1006,   3019,   5032,   7045,  -1006,  -3019,  -5032,  -7045,
+    // step_index=67, step=4428
+      1107,   3321,   5535,   7749,  -1107,  -3321,  -5535,  -7749,
+    // step_index=68, step=4871
+      1217,   3652,   6088,   8523,  -1217,  -3652,  -6088,  -8523,
+    // step_index=69, step=5358
+      1339,   4018,   6697,   9376,  -1339,  -4018,  -6697,  -9376,
+    // step_index=70, step=5894
+      1473,   4420,   7367,  10314,  -1473,  -4420,  -7367, -10314,
+    // step_index=71, step=6484
+      1621,   4863,   8105,  11347,  -1621,  -4863,  -8105, -11347,
+    // step_index=72, step=7132
+      1783,   5349,   8915,  12481,  -1783,  -5349,  -8915, -12481,
+    // step_index=73, step=7845
+      1961,   5883,   9806,  13728,  -1961,  -5883,  -9806, -13728,
+    // step_index=74, step=8630
+      2157,   6472,  10787,  15102,  -2157,  -6472, -10787, -15102,
+    // step_index=75, step=9493
+      2373,   7119,  11866,  16612,  -2373,  -7119, -11866, -16612,
+    // step_index=76, step=10442
+      2610,   7831,  13052,  18273,  -2610,  -7831, -13052, -18273,
+    // step_index=77, step=11487
+      2871,   8614,  14358,  20101,  -2871,  -8614, -14358, -20101,
+    // step_index=78, step=12635
+      3158,   9475,  15793,  22110,  -3158,  -9475, -15793, -22110,
+    // step_index=79, step=13899
+      3474,  10423,  17373,  24322,  -3474, -10423, -17373, -24322,
+    // step_index=80, step=15289
+      3822,  11466,  19111,  26755,  -3822, -11466, -19111, -26755,
+    // step_index=81, step=16818
+      4204,  12613,  21022,  29431,  -4204, -12613, -21022, -29431,
+    // step_index=82, step=18500
+      4625,  13875,  23125,  32375,  -4625, -13875, -23125, -32375,
+    // step_index=83, step=20350
+      5087,  15262,  25437,  35612,  -5087, -15262, -25437, -35612,
+    // step_index=84, step=22385
+      5596,  16788,  27981,  39173,  -5596, -16788, -27981, -39173,
+    // step_index=85, step=24623
+      6155,  18466,  30778,  43089,  -6155, -18466, -30778, -43089,
+    // step_index=86, step=27086
+      6771,  20314,  33857,  47400,  -6771, -20314, -33857, -47400,
+    // step_index=87, step=29794
+      7448,  22345,  37242,  52139,  -7448, -22345, -37242, -52139,
+    // step_index=88, step=32767
+      8191,  24574,  40958,  57341,  -8191, -24574, -40958, -57341,
+};
+
+#if GBS_BYTE_TABLES
+// Byte tables (ROM), generated by bench/gbs_tablegen.c into gbs_byte_tables.c
+// IMA: 89 step indices * 256 nibble pairs * 1 word (91136 bytes) + 22784 bytes
+// Two nibbles (low first): int16 diffs in a pair, final step_index
+extern const uint32_t ima_byte_diffs[89 * 256];
+extern const uint8_t ima_byte_step[89 * 256];
+// 2-bit: 89 step levels * 256 bytes * 2 words (182272 bytes) + 22784 bytes
+// All four codes of a byte: int16 deltas in pairs, final step_index / 4
+extern const uint32_t adpcm2_byte_deltas[89 * 256 * 2];
+extern const uint8_t adpcm2_byte_step[89 * 256];
+#endif
+
 // 2-bit ADPCM delta table (from savemu.dll 0x1000e388)
 // 356 entries: 89 step levels * 4 codes
 __attribute__((section(".iwram.rodata"))) static const int16_t adpcm2_delta_table[356] = {
@@ -323,7 +554,7 @@ typedef struct {
     char magic[4];          // "GBAL"
     uint32_t file_size;
     char marker[4];         // "MUSI"
-    uint32_t reserved1;
+    uint32_t sample_rate;   // PCM modes only; reserved in the M3 modes
     uint32_t mode;
     uint32_t reserved2[59]; // Padding to 0x200
 } __attribute__((packed)) GbsHeader;
@@ -334,22 +565,46 @@ typedef struct {
     int32_t step_index;     // Current step index
 } ChannelState;
 
+// Per-mode decoder binding: gbs_audio_init copies the mode's gbs_modes entry
+// into state.ops, so nothing downstream switches on the mode again
+typedef struct {
+    // Decode count samples per channel; right is NULL for mono
+    void (*decode)(int8_t* left, int8_t* right, uint32_t count);
+    // Load predictor and step index from a block header
+    void (*parse_header)(const uint8_t* block);
+    // Step the decoder count samples into the current block without
+    // writing PCM (count < samples_per_block; header already parsed)
+    void (*skip)(uint32_t count);
+    // Optional: point ring slot `slot` at the next buffer_samples of
+    // the source instead of decoding them; false if it cannot, then decode
+    bool (*map)(uint8_t slot);
+    uint32_t sample_rate;           // 0: from the GBS header
+    uint8_t channels;
+    uint32_t block_size;
+    uint32_t block_header_size;
+    uint32_t samples_per_block;     // Per channel; seeks map samples <-> blocks with it
+} GbsModeOps;
+
 // Internal audio state
 static struct {
     // GBS file info
     const uint8_t* gbs_data;
     uint32_t gbs_size;
     GbsAudioInfo info;
+    GbsBlockFetch block_fetch;  // Streaming: where blocks are (gbs_data is the header)
+    bool irq_decoding;          // The Timer1 IRQ is decoding: fetches must not wait
 
     // Decoder state
     ChannelState left;
     ChannelState right;     // Only used for stereo
 
+    // Mode binding (see GbsModeOps)
+    GbsModeOps ops;
+
     // Block tracking - current_block_ptr caches gbs_data + header + block_index * block_size
     const uint8_t* current_block_ptr;
     uint32_t block_index;
     uint32_t byte_in_block;
-    uint32_t block_header_size;
 
     // Buffered samples for multi-sample decoders
     // Mode 1 (3-bit): 8 samples per 3 bytes
@@ -361,24 +616,88 @@ static struct {
     bool have_high_nibble;
 
     // Playback state
-    volatile uint8_t active_buffer;
+    volatile uint8_t play_buffer;       // Ring slot DMA is playing
     bool is_paused;
-
-    // A/V sync: track minute boundaries using addition instead of division
-    // samples_per_minute = sample_rate * 60 (precomputed at init)
-    // next_minute_sample = threshold for next minute boundary
-    // current_audio_minute = which minute we're currently in (0-based)
+    bool loop;                          // Wrap to the start instead of finishing
+    uint32_t loops_decoded;             // Wraps the decoder has made
+
+    // Ring buffer: free-running counts of buffers decoded and started, so
+    // decoded - played is the number queued behind play_buffer. The IRQ
+    // advances buffers_played; buffers_decoded and decode_slot belong to
+    // whoever holds the decoder - gbs_audio_update() while producing is set,
+    // else the IRQ's emergency decode on an underrun.
+    uint8_t decode_slot;                // Next ring slot to decode into
+    volatile bool producing;
+    volatile uint32_t buffers_decoded;
+    volatile uint32_t buffers_played;
+
+    // Timer0 period: GBA_MASTER_CLOCK / sample_rate cycles is not whole
+    // (760.85 at 22050 Hz), so each buffer plays at timer_period or
+    // timer_period + 1, Bresenham style, keeping the long-run rate exact.
+    uint32_t timer_period;      // GBA_MASTER_CLOCK / sample_rate, rounded down
+    uint32_t timer_remainder;   // GBA_MASTER_CLOCK % sample_rate
+    uint32_t timer_error;       // Accumulated remainder, < sample_rate
+
+    // Playback clock: sample index (and loop count) at the start of the
+    // buffer DMA is playing. Taken from slot_start_sample / slot_loops by
+    // the Timer1 IRQ when it starts a buffer, so together with the live TM1
+    // count it gives the sample on air (see read_play_clock). Per slot,
+    // because a seek or loop makes the next buffer start anywhere.
+    volatile uint32_t buffer_start_sample;
+    volatile uint32_t buffer_loops;
+    uint32_t slot_start_sample[AUDIO_BUFFER_COUNT];
+    uint32_t slot_loops[AUDIO_BUFFER_COUNT];
+
+    // Live seek not heard yet: the buffer on air still plays from before
+    // it, so the clock reports the target until the Timer1 IRQ starts the
+    // first sought buffer (see gbs_audio_seek_sample)
+    volatile bool seek_pending;
+    uint32_t seek_sample;
+    uint32_t seek_loops;
+
+    // Underrun: the buffer on air is being replayed, so the clock holds at
+    // the end of its first play until the Timer1 IRQ starts a new buffer
+    volatile bool replaying;
+
+    // What DMA plays for each ring slot: its decode buffers, or the source
+    // data itself for modes that map (see GbsModeOps)
+    const int8_t* slot_left[AUDIO_BUFFER_COUNT];
+    const int8_t* slot_right[AUDIO_BUFFER_COUNT];
+
+    // sample_rate * 60 (precomputed at init, for gbs_audio_seek_minute)
     uint32_t samples_per_minute;
-    uint32_t next_minute_sample;
-    uint32_t current_audio_minute;      // Current minute (0, 1, 2, ...)
-    volatile int32_t sync_minute;       // New minute to sync to, or -1 if none pending
 } state;
 
-// Double buffers for decoded PCM (8-bit signed)
+// Ring of decoded PCM buffers (8-bit signed)
 // For stereo: left channel in buffer_left, right in buffer_right
 IWRAM_DATA static int8_t audio_buffer_left[AUDIO_BUFFER_COUNT][AUDIO_BUFFER_SAMPLES] __attribute__((aligned(4)));
 IWRAM_DATA static int8_t audio_buffer_right[AUDIO_BUFFER_COUNT][AUDIO_BUFFER_SAMPLES] __attribute__((aligned(4)));
 
+// Buffer latency for the next gbs_audio_init, 0 for the default. Outside
+// state, which init clears.
+static uint32_t requested_buffer_ms;
+
+// ============================================================================
+// Telemetry
+// ============================================================================
+// Counters for the whole session, across gbs_audio_init calls, until
+// gbs_audio_reset_stats. Bumped through AUDIO_STATS_* so that with
+// GBS_AUDIO_STATS off no code or data is left behind.
+
+#if GBS_AUDIO_STATS
+static GbsAudioStats stats;
+static uint64_t stats_irq_cycles_total;     // Sum for irq_cycles_mean
+
+#define AUDIO_STATS_INC(field)          (stats.field++)
+#define AUDIO_STATS_ADD(field, n)       (stats.field += (n))
+
+// Emulators and flash carts pick the save type from this ROM string
+__attribute__((used)) static const char stats_save_type[] = "SRAM_V113";
+#else
+#define AUDIO_STATS_INC(field)          ((void)0)
+#define AUDIO_STATS_ADD(field, n)       ((void)0)
+#endif
+
 // ============================================================================
 // ADPCM Decoding Functions
 // ============================================================================
@@ -401,31 +720,76 @@ static IWRAM_CODE int16_t decode_ima_4bit(uint8_t nibble, ChannelState* ch) {
     return (int16_t)ch->predictor;
 }
 
-// Decode single 3-bit ADPCM sample
-static IWRAM_CODE int16_t decode_adpcm_3bit(uint8_t code, ChannelState* ch) {
-    int step = ima_step_table[ch->step_index];
+#if GBS_BYTE_TABLES
+// Decode two 4-bit IMA codes of one channel (pair: first code in the low
+// nibble) into dest[0] and dest[1] with one table lookup. Only when neither
+// sample would saturate; otherwise fall back to decode_ima_4bit per code -
+// output is bit-exact either way.
+static inline void decode_ima_pair(uint32_t pair, ChannelState* ch, int8_t* dest) {
+    uint32_t entry = ((uint32_t)ch->step_index << 8) + pair;
+    uint32_t diffs = ima_byte_diffs[entry];
+    int32_t p1 = ch->predictor + (int16_t)diffs;
+    int32_t p2 = p1 + ((int32_t)diffs >> 16);
+
+    // Both within -32768..32767: offset, any out of range sets high bits
+    if ((uint32_t)((p1 + 0x8000) | (p2 + 0x8000)) <= 0xFFFF) {
+        ch->predictor = p2;
+        ch->step_index = ima_byte_step[entry];
+        dest[0] = (int8_t)(p1 >> 8);
+        dest[1] = (int8_t)(p2 >> 8);
+        return;
+    }
 
-    int diff = step >> 2;
-    if (code & 2) diff += step;
-    if (code & 1) diff += step >> 1;
+    dest[0] = (int8_t)(decode_ima_4bit(pair & 0x0F, ch) >> 8);
+    dest[1] = (int8_t)(decode_ima_4bit(pair >> 4, ch) >> 8);
+}
+#endif
 
-    if (code & 4) {
-        ch->predictor -= diff;
-    } else {
-        ch->predictor += diff;
-    }
+// One 3-bit ADPCM step on a predictor/step index pair; returns the new
+// predictor (unsigned 16-bit). Inlined so callers can keep both in registers.
+static inline int32_t adpcm3_step(int32_t* predictor, int32_t* step_index, uint32_t code) {
+    // Signed diff from the table replaces the step/2, step/4 and sign branches
+    int32_t p = *predictor + adpcm3_diff_table[(*step_index << 3) + code];
 
     // Clamp to unsigned 16-bit (0-65535)
-    if (ch->predictor < 0) ch->predictor = 0;
-    else if (ch->predictor > 65535) ch->predictor = 65535;
+    if (p < 0) p = 0;
+    else if (p > 65535) p = 65535;
+    *predictor = p;
 
     // Update step index
-    ch->step_index += adpcm3_index_table[code & 7];
-    if (ch->step_index < 0) ch->step_index = 0;
-    else if (ch->step_index > 88) ch->step_index = 88;
+    int32_t index = *step_index + adpcm3_index_table[code];
+    if (index < 0) index = 0;
+    else if (index > 88) index = 88;
+    *step_index = index;
+
+    return p;
+}
+
+// Decode single 3-bit ADPCM sample
+static IWRAM_CODE int16_t decode_adpcm_3bit(uint8_t code, ChannelState* ch) {
+    int32_t predictor = adpcm3_step(&ch->predictor, &ch->step_index, code & 7);
 
     // Return as signed (centered at 0x8000)
-    return (int16_t)(ch->predictor - 0x8000);
+    return (int16_t)(predictor - 0x8000);
+}
+
+// Decode the 8 samples of a 3-bit group (sample 0 in the low bits) straight
+// to 8-bit output, unrolled, with predictor and step index held in locals
+static inline void decode_adpcm3_group(uint32_t packed, ChannelState* ch, int8_t* dest) {
+    int32_t predictor = ch->predictor;
+    int32_t step_index = ch->step_index;
+
+    dest[0] = (int8_t)((adpcm3_step(&predictor, &step_index, packed & 7) - 0x8000) >> 8);
+    dest[1] = (int8_t)((adpcm3_step(&predictor, &step_index, (packed >> 3) & 7) - 0x8000) >> 8);
+    dest[2] = (int8_t)((adpcm3_step(&predictor, &step_index, (packed >> 6) & 7) - 0x8000) >> 8);
+    dest[3] = (int8_t)((adpcm3_step(&predictor, &step_index, (packed >> 9) & 7) - 0x8000) >> 8);
+    dest[4] = (int8_t)((adpcm3_step(&predictor, &step_index, (packed >> 12) & 7) - 0x8000) >> 8);
+    dest[5] = (int8_t)((adpcm3_step(&predictor, &step_index, (packed >> 15) & 7) - 0x8000) >> 8);
+    dest[6] = (int8_t)((adpcm3_step(&predictor, &step_index, (packed >> 18) & 7) - 0x8000) >> 8);
+    dest[7] = (int8_t)((adpcm3_step(&predictor, &step_index, packed >> 21) - 0x8000) >> 8);
+
+    ch->predictor = predictor;
+    ch->step_index = step_index;
 }
 
 // Decode single 2-bit ADPCM sample
@@ -452,6 +816,41 @@ static IWRAM_CODE int16_t decode_adpcm_2bit(uint8_t code, ChannelState* ch) {
     return (int16_t)(ch->predictor - 0x8000);
 }
 
+#if GBS_BYTE_TABLES
+// Decode the four 2-bit codes of a byte (code 0 in the low bits) with one
+// table lookup. Only for step indices on the table's multiple-of-4 grid and
+// predictors that stay off the 0/65535 rails; otherwise fall back to
+// decode_adpcm_2bit per code - output is bit-exact either way.
+static inline void decode_adpcm2_byte(uint32_t byte, ChannelState* ch, int8_t* dest) {
+    if ((ch->step_index & 3) == 0) {
+        uint32_t entry = ((uint32_t)ch->step_index << 6) + byte;
+        const uint32_t* deltas = &adpcm2_byte_deltas[entry << 1];
+        uint32_t lo = deltas[0];
+        uint32_t hi = deltas[1];
+        int32_t p1 = ch->predictor + (int16_t)lo;
+        int32_t p2 = p1 + ((int32_t)lo >> 16);
+        int32_t p3 = p2 + (int16_t)hi;
+        int32_t p4 = p3 + ((int32_t)hi >> 16);
+
+        // All four within 0-65535: a negative or too-large one sets high bits
+        if ((uint32_t)(p1 | p2 | p3 | p4) <= 0xFFFF) {
+            ch->predictor = p4;
+            ch->step_index = adpcm2_byte_step[entry] << 2;
+            dest[0] = (int8_t)((p1 - 0x8000) >> 8);
+            dest[1] = (int8_t)((p2 - 0x8000) >> 8);
+            dest[2] = (int8_t)((p3 - 0x8000) >> 8);
+            dest[3] = (int8_t)((p4 - 0x8000) >> 8);
+            return;
+        }
+    }
+
+    dest[0] = (int8_t)(decode_adpcm_2bit(byte & 0x03, ch) >> 8);
+    dest[1] = (int8_t)(decode_adpcm_2bit((byte >> 2) & 0x03, ch) >> 8);
+    dest[2] = (int8_t)(decode_adpcm_2bit((byte >> 4) & 0x03, ch) >> 8);
+    dest[3] = (int8_t)(decode_adpcm_2bit(byte >> 6, ch) >> 8);
+}
+#endif
+
 // ============================================================================
 // Block Management
 // ============================================================================
@@ -460,25 +859,37 @@ static inline const uint8_t* get_current_block(void) {
     return state.current_block_ptr;
 }
 
-static IWRAM_CODE void parse_block_header_mono(const uint8_t* block, ChannelState* ch) {
+// Block n of the data: in place after the header, or wherever the block
+// fetch hook has it when streaming
+static inline const uint8_t* block_address(uint32_t block) {
+    if (state.block_fetch) {
+        return state.block_fetch(block, !state.irq_decoding);
+    }
+    return state.gbs_data + GBS_HEADER_SIZE + block * state.info.block_size;
+}
+
+// Mode 2: IMA ADPCM with signed predictor
+static IWRAM_CODE void parse_block_header_ima_mono(const uint8_t* block) {
     uint16_t predictor = block[0] | (block[1] << 8);
     uint16_t step_idx = block[2] | (block[3] << 8);
+    state.left.predictor = (int16_t)(predictor - 0x8000);
+    state.left.step_index = (step_idx > 88) ? 88 : step_idx;
+}
 
-    // Mode 2 uses IMA ADPCM with signed predictor
-    if (state.info.mode == GBS_MODE_MONO_4BIT) {
-        ch->predictor = (int16_t)(predictor - 0x8000);
-    } else {
-        ch->predictor = predictor;
-    }
-    ch->step_index = step_idx;
+// Mode 1: unsigned predictor, IMA step range
+static IWRAM_CODE void parse_block_header_3bit(const uint8_t* block) {
+    uint16_t predictor = block[0] | (block[1] << 8);
+    uint16_t step_idx = block[2] | (block[3] << 8);
+    state.left.predictor = predictor;
+    state.left.step_index = (step_idx > 88) ? 88 : step_idx;
+}
 
-    // Clamp step index based on mode
-    if (state.info.mode == GBS_MODE_MONO_2BIT ||
-        state.info.mode == GBS_MODE_MONO_2BIT_SM) {
-        if (ch->step_index > 0x160) ch->step_index = 0x160;
-    } else {
-        if (ch->step_index > 88) ch->step_index = 88;
-    }
+// Modes 3/4: unsigned predictor, step index into adpcm2_delta_table
+static IWRAM_CODE void parse_block_header_2bit(const uint8_t* block) {
+    uint16_t predictor = block[0] | (block[1] << 8);
+    uint16_t step_idx = block[2] | (block[3] << 8);
+    state.left.predictor = predictor;
+    state.left.step_index = (step_idx > 0x160) ? 0x160 : step_idx;
 }
 
 static IWRAM_CODE void parse_block_header_stereo(const uint8_t* block) {
@@ -495,23 +906,35 @@ static IWRAM_CODE void parse_block_header_stereo(const uint8_t* block) {
     state.right.step_index = (step_r > 88) ? 88 : step_r;
 }
 
+// Looping: carry on from block 0 in the same buffer, so the end of the data
+// runs straight into the start. samples_decoded is added to by the buffer
+// decoders on return, so taking total_samples off here leaves it at the
+// position within the new pass.
+static IWRAM_CODE void wrap_to_start(void) {
+    state.block_index = 0;
+    state.current_block_ptr = block_address(0);
+    state.info.samples_decoded -= state.info.total_samples;
+    state.loops_decoded++;
+}
+
 static IWRAM_CODE void advance_to_next_block(void) {
+    AUDIO_STATS_INC(blocks_decoded[state.info.mode]);
     state.block_index++;
     state.byte_in_block = 0;
-    state.current_block_ptr += state.info.block_size;  // Just add block_size instead of multiply
 
     if (state.block_index >= state.info.total_blocks) {
-        state.info.is_finished = true;
-        return;
-    }
-
-    const uint8_t* block = state.current_block_ptr;
-
-    if (state.info.channels == 2) {
-        parse_block_header_stereo(block);
+        if (!state.loop) {
+            state.info.is_finished = true;
+            return;
+        }
+        wrap_to_start();
+    } else if (state.block_fetch) {
+        state.current_block_ptr = state.block_fetch(state.block_index, !state.irq_decoding);
     } else {
-        parse_block_header_mono(block, &state.left);
+        state.current_block_ptr += state.info.block_size;  // Just add block_size instead of multiply
     }
+
+    state.ops.parse_header(state.current_block_ptr);
 }
 
 // ============================================================================
@@ -520,8 +943,8 @@ static IWRAM_CODE void advance_to_next_block(void) {
 
 // Mode 0: Stereo 4-bit IMA ADPCM
 static IWRAM_CODE void decode_buffer_stereo_4bit(int8_t* left, int8_t* right, uint32_t count) {
-    const uint8_t* data = state.current_block_ptr + state.block_header_size;
-    uint32_t data_per_block = state.info.block_size - state.block_header_size;
+    const uint8_t* data = state.current_block_ptr + state.ops.block_header_size;
+    uint32_t data_per_block = state.info.block_size - state.ops.block_header_size;
     uint32_t byte_pos = state.byte_in_block;
     uint32_t decoded = 0;
 
@@ -530,7 +953,20 @@ static IWRAM_CODE void decode_buffer_stereo_4bit(int8_t* left, int8_t* right, ui
         uint32_t remaining_to_decode = count - decoded;
         uint32_t to_decode = remaining_in_block < remaining_to_decode ? remaining_in_block : remaining_to_decode;
 
-        for (uint32_t j = 0; j < to_decode; j++) {
+        uint32_t j = 0;
+#if GBS_BYTE_TABLES
+        // Two bytes at a time: their low nibbles are two left samples, their
+        // high nibbles two right ones - a nibble pair per channel
+        for (; j + 2 <= to_decode; j += 2) {
+            uint32_t byte0 = data[byte_pos];
+            uint32_t byte1 = data[byte_pos + 1];
+            byte_pos += 2;
+            decode_ima_pair((byte0 & 0x0F) | ((byte1 & 0x0F) << 4), &state.left, left + decoded);
+            decode_ima_pair((byte0 >> 4) | (byte1 & 0xF0), &state.right, right + decoded);
+            decoded += 2;
+        }
+#endif
+        for (; j < to_decode; j++) {
             uint32_t byte = data[byte_pos++];
             left[decoded] = (int8_t)(decode_ima_4bit(byte & 0x0F, &state.left) >> 8);
             right[decoded] = (int8_t)(decode_ima_4bit(byte >> 4, &state.right) >> 8);
@@ -540,12 +976,13 @@ static IWRAM_CODE void decode_buffer_stereo_4bit(int8_t* left, int8_t* right, ui
         if (byte_pos >= data_per_block) {
             state.byte_in_block = byte_pos;
             advance_to_next_block();
-            data = state.current_block_ptr + state.block_header_size;
+            data = state.current_block_ptr + state.ops.block_header_size;
             byte_pos = 0;
         }
     }
 
     // Fill remaining with silence if finished early
+    AUDIO_STATS_ADD(silence_samples, count - decoded);
     while (decoded < count) {
         left[decoded] = 0;
         right[decoded] = 0;
@@ -557,9 +994,9 @@ static IWRAM_CODE void decode_buffer_stereo_4bit(int8_t* left, int8_t* right, ui
 }
 
 // Mode 1: Mono 3-bit ADPCM (8 samples per 3 bytes)
-static IWRAM_CODE void decode_buffer_mono_3bit(int8_t* dest, uint32_t count) {
-    const uint8_t* data = state.current_block_ptr + state.block_header_size;
-    uint32_t data_per_block = state.info.block_size - state.block_header_size;
+static IWRAM_CODE void decode_buffer_mono_3bit(int8_t* dest, int8_t* right, uint32_t count) {
+    const uint8_t* data = state.current_block_ptr + state.ops.block_header_size;
+    uint32_t data_per_block = state.info.block_size - state.ops.block_header_size;
     uint32_t byte_pos = state.byte_in_block;
     uint32_t decoded = 0;
 
@@ -575,7 +1012,7 @@ static IWRAM_CODE void decode_buffer_mono_3bit(int8_t* dest, uint32_t count) {
             state.byte_in_block = byte_pos;
             advance_to_next_block();
             if (state.info.is_finished) break;
-            data = state.current_block_ptr + state.block_header_size;
+            data = state.current_block_ptr + state.ops.block_header_size;
             byte_pos = 0;
         }
 
@@ -585,21 +1022,8 @@ static IWRAM_CODE void decode_buffer_mono_3bit(int8_t* dest, uint32_t count) {
         byte_pos += 3;
 
         // Decode 8 samples from LSB (sample 0) to MSB (sample 7)
-        dest[decoded++] = (int8_t)(decode_adpcm_3bit(packed & 0x07, &state.left) >> 8);
-        packed >>= 3;
-        dest[decoded++] = (int8_t)(decode_adpcm_3bit(packed & 0x07, &state.left) >> 8);
-        packed >>= 3;
-        dest[decoded++] = (int8_t)(decode_adpcm_3bit(packed & 0x07, &state.left) >> 8);
-        packed >>= 3;
-        dest[decoded++] = (int8_t)(decode_adpcm_3bit(packed & 0x07, &state.left) >> 8);
-        packed >>= 3;
-        dest[decoded++] = (int8_t)(decode_adpcm_3bit(packed & 0x07, &state.left) >> 8);
-        packed >>= 3;
-        dest[decoded++] = (int8_t)(decode_adpcm_3bit(packed & 0x07, &state.left) >> 8);
-        packed >>= 3;
-        dest[decoded++] = (int8_t)(decode_adpcm_3bit(packed & 0x07, &state.left) >> 8);
-        packed >>= 3;
-        dest[decoded++] = (int8_t)(decode_adpcm_3bit(packed & 0x07, &state.left) >> 8);
+        decode_adpcm3_group(packed, &state.left, dest + decoded);
+        decoded += 8;
     }
 
     // Handle remaining samples (less than 8 needed)
@@ -608,7 +1032,7 @@ static IWRAM_CODE void decode_buffer_mono_3bit(int8_t* dest, uint32_t count) {
             state.byte_in_block = byte_pos;
             advance_to_next_block();
             if (!state.info.is_finished) {
-                data = state.current_block_ptr + state.block_header_size;
+                data = state.current_block_ptr + state.ops.block_header_size;
                 byte_pos = 0;
             }
         }
@@ -641,6 +1065,7 @@ static IWRAM_CODE void decode_buffer_mono_3bit(int8_t* dest, uint32_t count) {
         }
     }
 
+    AUDIO_STATS_ADD(silence_samples, count - decoded);
     while (decoded < count) dest[decoded++] = 0;
 
     state.byte_in_block = byte_pos;
@@ -648,9 +1073,9 @@ static IWRAM_CODE void decode_buffer_mono_3bit(int8_t* dest, uint32_t count) {
 }
 
 // Mode 2: Mono 4-bit IMA ADPCM
-static IWRAM_CODE void decode_buffer_mono_4bit(int8_t* dest, uint32_t count) {
-    const uint8_t* data = state.current_block_ptr + state.block_header_size;
-    uint32_t data_per_block = state.info.block_size - state.block_header_size;
+static IWRAM_CODE void decode_buffer_mono_4bit(int8_t* dest, int8_t* right, uint32_t count) {
+    const uint8_t* data = state.current_block_ptr + state.ops.block_header_size;
+    uint32_t data_per_block = state.info.block_size - state.ops.block_header_size;
     uint32_t byte_pos = state.byte_in_block;
     uint32_t decoded = 0;
 
@@ -666,13 +1091,18 @@ static IWRAM_CODE void decode_buffer_mono_4bit(int8_t* dest, uint32_t count) {
             state.byte_in_block = byte_pos;
             advance_to_next_block();
             if (state.info.is_finished) break;
-            data = state.current_block_ptr + state.block_header_size;
+            data = state.current_block_ptr + state.ops.block_header_size;
             byte_pos = 0;
         }
 
         uint32_t byte = data[byte_pos++];
+#if GBS_BYTE_TABLES
+        decode_ima_pair(byte, &state.left, dest + decoded);
+        decoded += 2;
+#else
         dest[decoded++] = (int8_t)(decode_ima_4bit(byte & 0x0F, &state.left) >> 8);
         dest[decoded++] = (int8_t)(decode_ima_4bit(byte >> 4, &state.left) >> 8);
+#endif
     }
 
     // Handle odd sample at end
@@ -681,7 +1111,7 @@ static IWRAM_CODE void decode_buffer_mono_4bit(int8_t* dest, uint32_t count) {
             state.byte_in_block = byte_pos;
             advance_to_next_block();
             if (!state.info.is_finished) {
-                data = state.current_block_ptr + state.block_header_size;
+                data = state.current_block_ptr + state.ops.block_header_size;
                 byte_pos = 0;
             }
         }
@@ -693,6 +1123,7 @@ static IWRAM_CODE void decode_buffer_mono_4bit(int8_t* dest, uint32_t count) {
         }
     }
 
+    AUDIO_STATS_ADD(silence_samples, count - decoded);
     while (decoded < count) dest[decoded++] = 0;
 
     state.byte_in_block = byte_pos;
@@ -700,9 +1131,9 @@ static IWRAM_CODE void decode_buffer_mono_4bit(int8_t* dest, uint32_t count) {
 }
 
 // Mode 3/4: Mono 2-bit ADPCM (4 samples per byte)
-static IWRAM_CODE void decode_buffer_mono_2bit(int8_t* dest, uint32_t count) {
-    const uint8_t* data = state.current_block_ptr + state.block_header_size;
-    uint32_t data_per_block = state.info.block_size - state.block_header_size;
+static IWRAM_CODE void decode_buffer_mono_2bit(int8_t* dest, int8_t* right, uint32_t count) {
+    const uint8_t* data = state.current_block_ptr + state.ops.block_header_size;
+    uint32_t data_per_block = state.info.block_size - state.ops.block_header_size;
     uint32_t byte_pos = state.byte_in_block;
     uint32_t decoded = 0;
 
@@ -718,11 +1149,15 @@ static IWRAM_CODE void decode_buffer_mono_2bit(int8_t* dest, uint32_t count) {
             state.byte_in_block = byte_pos;
             advance_to_next_block();
             if (state.info.is_finished) break;
-            data = state.current_block_ptr + state.block_header_size;
+            data = state.current_block_ptr + state.ops.block_header_size;
             byte_pos = 0;
         }
 
         uint32_t byte = data[byte_pos++];
+#if GBS_BYTE_TABLES
+        decode_adpcm2_byte(byte, &state.left, dest + decoded);
+        decoded += 4;
+#else
         dest[decoded++] = (int8_t)(decode_adpcm_2bit(byte & 0x03, &state.left) >> 8);
         byte >>= 2;
         dest[decoded++] = (int8_t)(decode_adpcm_2bit(byte & 0x03, &state.left) >> 8);
@@ -730,6 +1165,7 @@ static IWRAM_CODE void decode_buffer_mono_2bit(int8_t* dest, uint32_t count) {
         dest[decoded++] = (int8_t)(decode_adpcm_2bit(byte & 0x03, &state.left) >> 8);
         byte >>= 2;
         dest[decoded++] = (int8_t)(decode_adpcm_2bit(byte & 0x03, &state.left) >> 8);
+#endif
     }
 
     // Handle remaining samples (less than 4 needed)
@@ -738,7 +1174,7 @@ static IWRAM_CODE void decode_buffer_mono_2bit(int8_t* dest, uint32_t count) {
             state.byte_in_block = byte_pos;
             advance_to_next_block();
             if (!state.info.is_finished) {
-                data = state.current_block_ptr + state.block_header_size;
+                data = state.current_block_ptr + state.ops.block_header_size;
                 byte_pos = 0;
             }
         }
@@ -760,93 +1196,454 @@ static IWRAM_CODE void decode_buffer_mono_2bit(int8_t* dest, uint32_t count) {
         }
     }
 
+    AUDIO_STATS_ADD(silence_samples, count - decoded);
     while (decoded < count) dest[decoded++] = 0;
 
     state.byte_in_block = byte_pos;
     state.info.samples_decoded += decoded;
 }
 
-// Dispatch to appropriate decoder
-// Note: For mono modes, right is always NULL (DMA2 not used), so no need to clear it
-static IWRAM_CODE void decode_buffer(int8_t* left, int8_t* right, uint32_t count) {
-    switch (state.info.mode) {
-        case GBS_MODE_STEREO_4BIT:
-            decode_buffer_stereo_4bit(left, right, count);
-            break;
-        case GBS_MODE_MONO_3BIT:
-            decode_buffer_mono_3bit(left, count);
-            break;
-        case GBS_MODE_MONO_4BIT:
-            decode_buffer_mono_4bit(left, count);
-            break;
-        case GBS_MODE_MONO_2BIT:
-        case GBS_MODE_MONO_2BIT_SM:
-            decode_buffer_mono_2bit(left, count);
-            break;
-        default:
-            memset(left, 0, count);
-            break;
+// ============================================================================
+// Seek Skipping
+// ============================================================================
+// Each skip leaves the decoder exactly as its buffer decoder would after
+// producing count samples from the start of the block - including the
+// buffered tail of a partly used byte or group - so the next buffer
+// continues with the sample after the last one skipped.
+
+// Mode 0: 1 sample pair per byte
+static void skip_stereo_4bit(uint32_t count) {
+    const uint8_t* data = state.current_block_ptr + state.ops.block_header_size;
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t byte = data[i];
+        decode_ima_4bit(byte & 0x0F, &state.left);
+        decode_ima_4bit(byte >> 4, &state.right);
+    }
+    state.byte_in_block = count;
+}
+
+// Mode 1: 8 samples per 3 bytes; a partial group is buffered
+static void skip_mono_3bit(uint32_t count) {
+    const uint8_t* data = state.current_block_ptr + state.ops.block_header_size;
+    uint32_t byte_pos = 0;
+
+    for (uint32_t groups = count >> 3; groups > 0; groups--) {
+        uint32_t packed = (data[byte_pos] << 16) | (data[byte_pos + 1] << 8) | data[byte_pos + 2];
+        byte_pos += 3;
+        for (int k = 0; k < 8; k++) {
+            adpcm3_step(&state.left.predictor, &state.left.step_index, packed & 0x07);
+            packed >>= 3;
+        }
+    }
+
+    uint32_t used = count & 7;
+    if (used) {
+        uint32_t packed = (data[byte_pos] << 16) | (data[byte_pos + 1] << 8) | data[byte_pos + 2];
+        byte_pos += 3;
+        for (int k = 0; k < 8; k++) {
+            state.buffered_samples[k] = decode_adpcm_3bit(packed & 0x07, &state.left);
+            packed >>= 3;
+        }
+        state.samples_buffered = 8 - used;
+    }
+    state.byte_in_block = byte_pos;
+}
+
+// Mode 2: 2 samples per byte; an odd count leaves the high nibble buffered
+static void skip_mono_4bit(uint32_t count) {
+    const uint8_t* data = state.current_block_ptr + state.ops.block_header_size;
+    uint32_t byte_pos = 0;
+
+    for (uint32_t bytes = count >> 1; bytes > 0; bytes--) {
+        uint32_t byte = data[byte_pos++];
+        decode_ima_4bit(byte & 0x0F, &state.left);
+        decode_ima_4bit(byte >> 4, &state.left);
+    }
+
+    if (count & 1) {
+        uint32_t byte = data[byte_pos++];
+        decode_ima_4bit(byte & 0x0F, &state.left);
+        state.high_nibble_sample = decode_ima_4bit(byte >> 4, &state.left);
+        state.have_high_nibble = true;
+    }
+    state.byte_in_block = byte_pos;
+}
+
+// Modes 3/4: 4 samples per byte; a partial byte is buffered
+static void skip_mono_2bit(uint32_t count) {
+    const uint8_t* data = state.current_block_ptr + state.ops.block_header_size;
+    uint32_t byte_pos = 0;
+
+    for (uint32_t bytes = count >> 2; bytes > 0; bytes--) {
+        uint32_t byte = data[byte_pos++];
+        for (int k = 0; k < 4; k++) {
+            decode_adpcm_2bit(byte & 0x03, &state.left);
+            byte >>= 2;
+        }
     }
+
+    uint32_t used = count & 3;
+    if (used) {
+        uint32_t byte = data[byte_pos++];
+        for (int k = 0; k < 4; k++) {
+            state.buffered_samples[k] = decode_adpcm_2bit(byte & 0x03, &state.left);
+            byte >>= 2;
+        }
+        state.samples_buffered = 4 - used;
+    }
+    state.byte_in_block = byte_pos;
 }
 
 // ============================================================================
-// Interrupt Handler
+// 8-bit PCM
 // ============================================================================
+// Modes 5/6 are signed 8-bit samples, ready for the FIFO: mono is one run of
+// samples, stereo all left samples then all right, so any stretch of either
+// channel is contiguous. Each sample is a 1-byte "block" (2 for stereo, one
+// per plane) with no header, so a seek lands on the block itself.
 
-static IWRAM_CODE void audio_timer1_handler(void) {
-    REG_IF = IRQ_TIMER1;
+// Nothing to load: PCM carries no decoder state
+static void parse_block_header_pcm(const uint8_t* block) {
+}
 
-    if (state.info.is_finished) {
-        REG_DMA1CNT = 0;
-        REG_DMA2CNT = 0;
-        state.info.is_playing = false;
-        return;
+static void skip_pcm(uint32_t count) {
+}
+
+// End of the PCM data after the current buffer's samples
+static IWRAM_CODE void pcm_end_of_data(void) {
+    if (state.loop) {
+        wrap_to_start();
+    } else {
+        state.info.is_finished = true;
     }
+}
 
-    // Swap buffers
-    uint8_t play_buffer = state.active_buffer;
-    uint8_t decode_buffer_idx = play_buffer ^ 1;
-    state.active_buffer = decode_buffer_idx;
+// Play the next buffer straight from ROM. DMA moves words, so both channels
+// must be word aligned, and the buffer must not run off the end (the tail
+// and the wrap of a loop are staged by decode_buffer_pcm instead).
+static IWRAM_CODE bool map_buffer_pcm(uint8_t slot) {
+    const int8_t* data = (const int8_t*)(state.gbs_data + GBS_HEADER_SIZE);
+    uint32_t total = state.info.total_samples;
+    uint32_t pos = state.info.samples_decoded;
+    const int8_t* left = data + pos;
+    const int8_t* right = left + total;
+
+    // Stereo needs the right plane word aligned too (wav_to_gbs pads each
+    // plane to a multiple of 4 samples); mono has no right plane
+    uintptr_t align = (uintptr_t)left;
+    if (state.info.channels == 2) align |= (uintptr_t)right;
+    if (pos + state.info.buffer_samples > total || (align & 3)) {
+        return false;
+    }
+
+    state.slot_left[slot] = left;
+    state.slot_right[slot] = right;
+    AUDIO_STATS_ADD(blocks_decoded[state.info.mode], state.info.buffer_samples);
+    state.info.samples_decoded += state.info.buffer_samples;
+    if (pos + state.info.buffer_samples == total) {
+        pcm_end_of_data();
+    }
+    return true;
+}
+
+// Staging copy into the decode buffers, for buffers map_buffer_pcm cannot
+// play in place
+static IWRAM_CODE void decode_buffer_pcm(int8_t* left, int8_t* right, uint32_t count) {
+    const int8_t* data = (const int8_t*)(state.gbs_data + GBS_HEADER_SIZE);
+    uint32_t total = state.info.total_samples;
+    uint32_t decoded = 0;
+
+    while (!state.info.is_finished && decoded < count) {
+        uint32_t pos = state.info.samples_decoded + decoded;
+        uint32_t n = total - pos;
+        if (n > count - decoded) n = count - decoded;
+
+        memcpy(left + decoded, data + pos, n);
+        if (right) {
+            memcpy(right + decoded, data + total + pos, n);
+        }
+        AUDIO_STATS_ADD(blocks_decoded[state.info.mode], n);
+        decoded += n;
+
+        if (pos + n == total) {
+            pcm_end_of_data();
+        }
+    }
 
-    // Restart DMA for new buffer
+    // Fill remaining with silence if finished early
+    if (decoded < count) {
+        AUDIO_STATS_ADD(silence_samples, count - decoded);
+        memset(left + decoded, 0, count - decoded);
+        if (right) {
+            memset(right + decoded, 0, count - decoded);
+        }
+    }
+
+    state.info.samples_decoded += decoded;
+}
+
+// ============================================================================
+// Mode Table
+// ============================================================================
+
+// Indexed by GbsMode
+static const GbsModeOps gbs_modes[GBS_MODE_COUNT] = {
+    [GBS_MODE_STEREO_4BIT] = {
+        .decode = decode_buffer_stereo_4bit,
+        .parse_header = parse_block_header_stereo,
+        .skip = skip_stereo_4bit,
+        .sample_rate = 22050,
+        .channels = 2,
+        .block_size = 0x400,
+        .block_header_size = 8,                     // 4 bytes per channel
+        .samples_per_block = 0x400 - 8,             // 1 sample pair per byte
+    },
+    [GBS_MODE_MONO_3BIT] = {
+        .decode = decode_buffer_mono_3bit,
+        .parse_header = parse_block_header_3bit,
+        .skip = skip_mono_3bit,
+        .sample_rate = 44100,                       // 11:1 compression vs 44.1kHz 16-bit stereo
+        .channels = 1,
+        .block_size = 0x400,
+        .block_header_size = 4,
+        .samples_per_block = (0x400 - 4) / 3 * 8,   // 8 samples per 3 bytes
+    },
+    [GBS_MODE_MONO_4BIT] = {
+        .decode = decode_buffer_mono_4bit,
+        .parse_header = parse_block_header_ima_mono,
+        .skip = skip_mono_4bit,
+        .sample_rate = 22050,
+        .channels = 1,
+        .block_size = 0x200,
+        .block_header_size = 4,
+        .samples_per_block = (0x200 - 4) * 2,       // 2 samples per byte
+    },
+    [GBS_MODE_MONO_2BIT] = {
+        .decode = decode_buffer_mono_2bit,
+        .parse_header = parse_block_header_2bit,
+        .skip = skip_mono_2bit,
+        .sample_rate = 22050,
+        .channels = 1,
+        .block_size = 0x200,
+        .block_header_size = 4,
+        .samples_per_block = (0x200 - 4) * 4,       // 4 samples per byte
+    },
+    [GBS_MODE_MONO_2BIT_SM] = {
+        .decode = decode_buffer_mono_2bit,
+        .parse_header = parse_block_header_2bit,
+        .skip = skip_mono_2bit,
+        .sample_rate = 11025,
+        .channels = 1,
+        .block_size = 0x100,
+        .block_header_size = 4,
+        .samples_per_block = (0x100 - 4) * 4,       // 4 samples per byte
+    },
+    [GBS_MODE_PCM8_MONO] = {
+        .decode = decode_buffer_pcm,
+        .parse_header = parse_block_header_pcm,
+        .skip = skip_pcm,
+        .map = map_buffer_pcm,
+        .sample_rate = 0,
+        .channels = 1,
+        .block_size = 1,
+        .block_header_size = 0,
+        .samples_per_block = 1,
+    },
+    [GBS_MODE_PCM8_STEREO] = {
+        .decode = decode_buffer_pcm,
+        .parse_header = parse_block_header_pcm,
+        .skip = skip_pcm,
+        .map = map_buffer_pcm,
+        .sample_rate = 0,
+        .channels = 2,
+        .block_size = 2,                            // 1 byte in each plane
+        .block_header_size = 0,
+        .samples_per_block = 1,
+    },
+};
+
+// Decode through the kernel bound at init
+// Note: For mono modes, right is always NULL (DMA2 not used), so no need to clear it
+static inline void decode_buffer(int8_t* left, int8_t* right, uint32_t count) {
+    state.ops.decode(left, right, count);
+}
+
+// ============================================================================
+// Ring Buffer Producer
+// ============================================================================
+
+// Decode the next buffer_samples into decode_slot and queue it
+static IWRAM_CODE void produce_buffer(void) {
+    uint8_t slot = state.decode_slot;
+    state.slot_start_sample[slot] = state.info.samples_decoded;
+    state.slot_loops[slot] = state.loops_decoded;
+    if (!state.ops.map || !state.ops.map(slot)) {
+        state.slot_left[slot] = audio_buffer_left[slot];
+        state.slot_right[slot] = audio_buffer_right[slot];
+        decode_buffer(audio_buffer_left[slot],
+                      state.info.channels == 2 ? audio_buffer_right[slot] : NULL,
+                      state.info.buffer_samples);
+    }
+    state.decode_slot = (slot + 1 == AUDIO_BUFFER_COUNT) ? 0 : slot + 1;
+    state.buffers_decoded++;
+}
+
+// ============================================================================
+// Interrupt Handler
+// ============================================================================
+
+// Timer0 reload for the next buffer: one cycle longer whenever the
+// accumulated fractional cycles reach a whole one per sample
+static inline uint16_t next_timer_reload(void) {
+    uint32_t period = state.timer_period;
+    state.timer_error += state.timer_remainder;
+    if (state.timer_error >= state.info.sample_rate) {
+        state.timer_error -= state.info.sample_rate;
+        period++;
+    }
+    return (uint16_t)(65536 - period);
+}
+
+// Point DMA at the start of what ring slot `slot` plays
+static IWRAM_CODE void start_buffer_dma(uint8_t slot) {
     REG_DMA1CNT = 0;
-    REG_DMA1SAD = (uint32_t)audio_buffer_left[decode_buffer_idx];
+    REG_DMA1SAD = (uint32_t)state.slot_left[slot];
     REG_DMA1DAD = (uint32_t)&REG_FIFO_A;
     REG_DMA1CNT = DMA_DST_FIXED | DMA_SRC_INC | DMA_REPEAT | DMA32 | DMA_SPECIAL | DMA_ENABLE;
 
     if (state.info.channels == 2) {
         REG_DMA2CNT = 0;
-        REG_DMA2SAD = (uint32_t)audio_buffer_right[decode_buffer_idx];
+        REG_DMA2SAD = (uint32_t)state.slot_right[slot];
         REG_DMA2DAD = (uint32_t)&REG_FIFO_B;
         REG_DMA2CNT = DMA_DST_FIXED | DMA_SRC_INC | DMA_REPEAT | DMA32 | DMA_SPECIAL | DMA_ENABLE;
     }
+}
+
+// Buffer boundary: move DMA on to the next queued buffer
+static inline void swap_buffers(void) {
+    REG_IF = IRQ_TIMER1;
+
+    uint32_t queued = state.buffers_decoded - state.buffers_played;
+    if (queued == 0 && state.info.is_finished) {
+        // Ring drained at the end of the data
+        REG_DMA1CNT = 0;
+        REG_DMA2CNT = 0;
+        state.info.is_playing = false;
+        state.seek_pending = false;
+        state.replaying = false;
+        return;
+    }
+
+    // Period for the next buffer (Timer0 picks it up at its next overflow,
+    // one sample in - the average is unaffected)
+    REG_TM0CNT_L = next_timer_reload();
+
+    if (queued == 0) {
+        // Underrun: nothing decoded behind this buffer. Replay it rather
+        // than play a half-decoded one; the clock holds (see replaying).
+        AUDIO_STATS_INC(underruns);
+        state.replaying = true;
+        start_buffer_dma(state.play_buffer);
+
+        // Emergency fallback: the main loop is not decoding either, so
+        // decode the next buffer here, as the double-buffered player always
+        // did. Only now: this holds off every other IRQ for a whole decode.
+        if (!state.producing && !state.info.is_finished) {
+            AUDIO_STATS_INC(irq_decodes);
+            state.irq_decoding = true;
+            produce_buffer();
+            state.irq_decoding = false;
+        }
+        return;
+    }
+
+    // Advance to the next queued buffer
+    uint8_t next = state.play_buffer + 1;
+    if (next == AUDIO_BUFFER_COUNT) next = 0;
+    state.play_buffer = next;
+    state.buffers_played++;
+    state.seek_pending = false;
+    state.replaying = false;
+    state.buffer_start_sample = state.slot_start_sample[next];
+    state.buffer_loops = state.slot_loops[next];
+    start_buffer_dma(next);
+}
 
-    // Decode into buffer that just finished playing
-    decode_buffer(audio_buffer_left[play_buffer],
-                  state.info.channels == 2 ? audio_buffer_right[play_buffer] : NULL,
-                  AUDIO_BUFFER_SAMPLES);
-
-    // Check if we crossed a minute boundary (using comparison instead of division)
-    if (state.info.samples_decoded >= state.next_minute_sample) {
-        // Crossed into next minute
-        state.current_audio_minute++;
-        state.next_minute_sample += state.samples_per_minute;
-        // Signal sync to the new minute
-        state.sync_minute = (int32_t)state.current_audio_minute;
+#if GBS_AUDIO_STATS
+// CPU cycles from the Timer2 + Timer3 pair; read the high half around the
+// low so a carry between the two reads is not torn
+static inline uint32_t read_cycle_counter(void) {
+    uint32_t high, low;
+    do {
+        high = REG_TM3CNT_L;
+        low = REG_TM2CNT_L;
+    } while (high != REG_TM3CNT_L);
+    return high << 16 | low;
+}
+
+static void start_cycle_counter(void) {
+    if (REG_TM2CNT_H & TIMER_START) return;
+    REG_TM3CNT_H = 0;
+    REG_TM3CNT_L = 0;
+    REG_TM3CNT_H = TIMER_CASCADE | TIMER_START;
+    REG_TM2CNT_H = 0;
+    REG_TM2CNT_L = 0;
+    REG_TM2CNT_H = TIMER_START;             // Prescaler 1: one tick per cycle
+}
+
+static IWRAM_CODE void audio_timer1_handler(void) {
+    uint32_t entry = read_cycle_counter();
+
+    // TM1 restarted from its reload at the overflow and has counted the
+    // samples played since; any at all means the IRQ was held off past the
+    // first sample of the next buffer
+    uint32_t late = (uint16_t)(REG_TM1CNT_L - (65536 - state.info.buffer_samples));
+    if (late) {
+        stats.late_swaps++;
+        if (late > stats.max_late_samples) stats.max_late_samples = late;
     }
+
+    swap_buffers();
+
+    uint32_t cycles = read_cycle_counter() - entry;
+    stats.irq_count++;
+    stats_irq_cycles_total += cycles;
+    if (cycles > stats.irq_cycles_max) stats.irq_cycles_max = cycles;
+}
+#else
+static IWRAM_CODE void audio_timer1_handler(void) {
+    swap_buffers();
 }
+#endif
 
 // ============================================================================
 // Public API
 // ============================================================================
 
-bool gbs_audio_init(const uint8_t* gbs_data, uint32_t gbs_size) {
-    // Clear state
-    memset(&state, 0, sizeof(state));
+// Buffer length for sample_rate: buffer_ms of audio, or if 0
+// AUDIO_BUFFER_SAMPLES scaled from 22050 Hz (the same ~46 ms, 21.5 IRQs/s,
+// at every rate), rounded to a multiple of 16 and kept within the pool
+static uint32_t choose_buffer_samples(uint32_t sample_rate, uint32_t buffer_ms) {
+    uint32_t samples;
+    if (buffer_ms) {
+        samples = sample_rate * buffer_ms / 1000;
+    } else {
+        samples = AUDIO_BUFFER_SAMPLES * sample_rate / 22050;
+    }
 
-    state.gbs_data = gbs_data;
-    state.gbs_size = gbs_size;
-    state.info.mode = GBS_MODE_INVALID;
+    samples = (samples + 8) & ~15u;
+    if (samples < AUDIO_BUFFER_MIN_SAMPLES) samples = AUDIO_BUFFER_MIN_SAMPLES;
+    if (samples > AUDIO_BUFFER_SAMPLES) samples = AUDIO_BUFFER_SAMPLES;
+    return samples;
+}
+
+void gbs_audio_set_buffer_ms(uint32_t ms) {
+    requested_buffer_ms = ms;
+}
+
+bool gbs_audio_probe(const uint8_t* gbs_data, uint32_t gbs_size, GbsAudioInfo* info) {
+    memset(info, 0, sizeof(*info));
+    info->mode = GBS_MODE_INVALID;
 
     // Validate header
     if (gbs_size < GBS_HEADER_SIZE) {
@@ -860,117 +1657,111 @@ bool gbs_audio_init(const uint8_t* gbs_data, uint32_t gbs_size) {
         return false;
     }
 
-    if (header->mode > 4) {
+    if (header->mode >= GBS_MODE_COUNT) {
         return false;
     }
 
-    // Configure based on mode
-    state.info.mode = (GbsMode)header->mode;
-
-    switch (state.info.mode) {
-        case GBS_MODE_STEREO_4BIT:
-            state.info.sample_rate = 22050;
-            state.info.channels = 2;
-            state.info.block_size = 0x400;
-            state.block_header_size = 8;  // 4 bytes per channel
-            break;
-        case GBS_MODE_MONO_3BIT:
-            state.info.sample_rate = 44100;  // 11:1 compression vs 44.1kHz 16-bit stereo
-            state.info.channels = 1;
-            state.info.block_size = 0x400;
-            state.block_header_size = 4;
-            break;
-        case GBS_MODE_MONO_4BIT:
-            state.info.sample_rate = 22050;
-            state.info.channels = 1;
-            state.info.block_size = 0x200;
-            state.block_header_size = 4;
-            break;
-        case GBS_MODE_MONO_2BIT:
-            state.info.sample_rate = 22050;
-            state.info.channels = 1;
-            state.info.block_size = 0x200;
-            state.block_header_size = 4;
-            break;
-        case GBS_MODE_MONO_2BIT_SM:
-            state.info.sample_rate = 11025;
-            state.info.channels = 1;
-            state.info.block_size = 0x100;
-            state.block_header_size = 4;
-            break;
-        default:
+    // PCM plays at any of the M3 rates, given in the header
+    const GbsModeOps* ops = &gbs_modes[header->mode];
+    uint32_t sample_rate = ops->sample_rate;
+    if (sample_rate == 0) {
+        sample_rate = header->sample_rate;
+        if (sample_rate != 11025 && sample_rate != 22050 && sample_rate != 44100) {
             return false;
+        }
     }
 
+    info->mode = (GbsMode)header->mode;
+    info->sample_rate = sample_rate;
+    info->channels = ops->channels;
+    info->block_size = ops->block_size;
+
     // Calculate totals
     uint32_t data_size = gbs_size - GBS_HEADER_SIZE;
-    state.info.total_blocks = data_size / state.info.block_size;
-
-    // Calculate samples per block based on mode
-    uint32_t data_per_block = state.info.block_size - state.block_header_size;
-    uint32_t samples_per_block;
-
-    switch (state.info.mode) {
-        case GBS_MODE_STEREO_4BIT:
-            samples_per_block = data_per_block;  // 1 sample pair per byte
-            break;
-        case GBS_MODE_MONO_3BIT:
-            samples_per_block = (data_per_block / 3) * 8;  // 8 samples per 3 bytes
-            break;
-        case GBS_MODE_MONO_4BIT:
-            samples_per_block = data_per_block * 2;  // 2 samples per byte
-            break;
-        case GBS_MODE_MONO_2BIT:
-        case GBS_MODE_MONO_2BIT_SM:
-            samples_per_block = data_per_block * 4;  // 4 samples per byte
-            break;
-        default:
-            samples_per_block = 0;
+    info->total_blocks = data_size / info->block_size;
+    info->total_samples = info->total_blocks * ops->samples_per_block;
+    info->is_finished = (info->total_blocks == 0);
+    return true;
+}
+
+// Shared by gbs_audio_init and gbs_audio_init_stream: blocks are read
+// through fetch if it is set, else in place after the header
+static bool init_audio(const uint8_t* gbs_data, uint32_t gbs_size, GbsBlockFetch fetch) {
+    // Clear state
+    memset(&state, 0, sizeof(state));
+
+    state.gbs_data = gbs_data;
+    state.gbs_size = gbs_size;
+    state.block_fetch = fetch;
+
+    if (!gbs_audio_probe(gbs_data, gbs_size, &state.info)) {
+        return false;
+    }
+
+    // PCM is played in place by the sound DMA; it has no blocks to fetch
+    if (fetch && state.info.mode >= GBS_MODE_PCM8_MONO) {
+        state.info.mode = GBS_MODE_INVALID;
+        return false;
     }
 
-    state.info.total_samples = state.info.total_blocks * samples_per_block;
+    // Bind the mode's decoder and geometry
+    state.ops = gbs_modes[state.info.mode];
 
-    // Initialize first block pointer
-    state.current_block_ptr = gbs_data + GBS_HEADER_SIZE;
+    // Buffer length: as set by gbs_audio_set_buffer_ms, else the title's tag
+    uint32_t buffer_ms = requested_buffer_ms;
+    const uint8_t* tag = gbs_data + GBS_BUFFER_TAG_OFFSET;
+    if (buffer_ms == 0 && memcmp(tag, "BUFM", 4) == 0) {
+        buffer_ms = tag[4] | (tag[5] << 8);
+    }
+    state.info.buffer_samples = choose_buffer_samples(state.info.sample_rate, buffer_ms);
 
     // Initialize first block
     if (state.info.total_blocks > 0) {
-        if (state.info.channels == 2) {
-            parse_block_header_stereo(state.current_block_ptr);
-        } else {
-            parse_block_header_mono(state.current_block_ptr, &state.left);
-        }
+        state.current_block_ptr = block_address(0);
+        state.ops.parse_header(state.current_block_ptr);
     }
 
-    state.info.is_finished = (state.info.total_blocks == 0);
+    // Timer0 period as whole cycles plus a remainder (see next_timer_reload)
+    state.timer_period = GBA_MASTER_CLOCK / state.info.sample_rate;
+    state.timer_remainder = GBA_MASTER_CLOCK % state.info.sample_rate;
 
-    // Initialize A/V sync tracking
     // Precompute samples_per_minute to avoid runtime multiplication
     state.samples_per_minute = state.info.sample_rate * 60;
-    state.next_minute_sample = state.samples_per_minute;  // First boundary at minute 1
-    state.current_audio_minute = 0;  // Start at minute 0
-    state.sync_minute = -1;  // No sync pending initially
 
     return true;
 }
 
+bool gbs_audio_init(const uint8_t* gbs_data, uint32_t gbs_size) {
+    return init_audio(gbs_data, gbs_size, NULL);
+}
+
+bool gbs_audio_init_stream(const uint8_t* header, uint32_t gbs_size, GbsBlockFetch fetch) {
+    return init_audio(header, gbs_size, fetch);
+}
+
 void gbs_audio_start(void) {
     if (state.info.mode == GBS_MODE_INVALID || state.info.is_finished) {
         return;
     }
 
-    // Pre-decode both buffers
-    decode_buffer(audio_buffer_left[0],
-                  state.info.channels == 2 ? audio_buffer_right[0] : NULL,
-                  AUDIO_BUFFER_SAMPLES);
-    decode_buffer(audio_buffer_left[1],
-                  state.info.channels == 2 ? audio_buffer_right[1] : NULL,
-                  AUDIO_BUFFER_SAMPLES);
+    // Fill the ring: slot 0 plays first, the rest queue behind it
+    state.producing = false;
+    state.decode_slot = 0;
+    state.buffers_decoded = 0;
+    for (int i = 0; i < AUDIO_BUFFER_COUNT; i++) {
+        produce_buffer();
+    }
+    state.play_buffer = 0;
+    state.buffers_played = 1;
 
-    state.active_buffer = 0;
+    // Clock starts at the first pre-decoded sample
+    state.seek_pending = false;
+    state.buffer_start_sample = state.slot_start_sample[0];
+    state.buffer_loops = state.slot_loops[0];
 
-    // Calculate timer reload
-    uint16_t timer_reload = 65536 - (GBA_MASTER_CLOCK / state.info.sample_rate);
+    // Timer reload for the first buffer. timer_error carries over from the
+    // previous run so looping playback keeps the exact long-run rate
+    uint16_t timer_reload = next_timer_reload();
 
     // Enable sound
     REG_SOUNDCNT_X = SOUNDCNT_X_ENABLE;
@@ -1001,25 +1792,18 @@ void gbs_audio_start(void) {
 
     // Setup Timer1 cascade for buffer swap
     REG_TM1CNT_H = 0;
-    REG_TM1CNT_L = 65536 - AUDIO_BUFFER_SAMPLES;
+    REG_TM1CNT_L = 65536 - state.info.buffer_samples;
     REG_TM1CNT_H = TIMER_IRQ | TIMER_CASCADE | TIMER_START;
 
     // Setup interrupt
+#if GBS_AUDIO_STATS
+    start_cycle_counter();
+#endif
     irqSet(IRQ_TIMER1, audio_timer1_handler);
     irqEnable(IRQ_TIMER1);
 
     // Start DMA
-    REG_DMA1CNT = 0;
-    REG_DMA1SAD = (uint32_t)audio_buffer_left[0];
-    REG_DMA1DAD = (uint32_t)&REG_FIFO_A;
-    REG_DMA1CNT = DMA_DST_FIXED | DMA_SRC_INC | DMA_REPEAT | DMA32 | DMA_SPECIAL | DMA_ENABLE;
-
-    if (state.info.channels == 2) {
-        REG_DMA2CNT = 0;
-        REG_DMA2SAD = (uint32_t)audio_buffer_right[0];
-        REG_DMA2DAD = (uint32_t)&REG_FIFO_B;
-        REG_DMA2CNT = DMA_DST_FIXED | DMA_SRC_INC | DMA_REPEAT | DMA32 | DMA_SPECIAL | DMA_ENABLE;
-    }
+    start_buffer_dma(0);
 
     state.info.is_playing = true;
 }
@@ -1048,7 +1832,7 @@ void gbs_audio_pause(void) {
 void gbs_audio_resume(void) {
     if (!state.info.is_playing || !state.is_paused) return;
 
-    uint16_t timer_reload = 65536 - (GBA_MASTER_CLOCK / state.info.sample_rate);
+    uint16_t timer_reload = next_timer_reload();
 
     // Reset FIFOs to clear any stale data
     if (state.info.channels == 2) {
@@ -1062,17 +1846,7 @@ void gbs_audio_resume(void) {
     }
 
     // Restart DMA from current buffer position
-    REG_DMA1CNT = 0;
-    REG_DMA1SAD = (uint32_t)audio_buffer_left[state.active_buffer];
-    REG_DMA1DAD = (uint32_t)&REG_FIFO_A;
-    REG_DMA1CNT = DMA_DST_FIXED | DMA_SRC_INC | DMA_REPEAT | DMA32 | DMA_SPECIAL | DMA_ENABLE;
-
-    if (state.info.channels == 2) {
-        REG_DMA2CNT = 0;
-        REG_DMA2SAD = (uint32_t)audio_buffer_right[state.active_buffer];
-        REG_DMA2DAD = (uint32_t)&REG_FIFO_B;
-        REG_DMA2CNT = DMA_DST_FIXED | DMA_SRC_INC | DMA_REPEAT | DMA32 | DMA_SPECIAL | DMA_ENABLE;
-    }
+    start_buffer_dma(state.play_buffer);
 
     // Restart timers
     REG_TM0CNT_H = 0;
@@ -1080,36 +1854,35 @@ void gbs_audio_resume(void) {
     REG_TM0CNT_H = TIMER_START;
 
     REG_TM1CNT_H = 0;
-    REG_TM1CNT_L = 65536 - AUDIO_BUFFER_SAMPLES;
+    REG_TM1CNT_L = 65536 - state.info.buffer_samples;
     REG_TM1CNT_H = TIMER_IRQ | TIMER_CASCADE | TIMER_START;
 
     state.is_paused = false;
 }
 
+void gbs_audio_update(void) {
+    if (!state.info.is_playing) return;
+
+    // Claim the decoder before reading the counts, so an IRQ that lands
+    // between the check and the decode sees producing and leaves it alone
+    state.producing = true;
+    while (state.buffers_decoded - state.buffers_played < AUDIO_BUFFER_COUNT - 1 &&
+           !state.info.is_finished) {
+        produce_buffer();
+    }
+    state.producing = false;
+}
+
 bool gbs_audio_is_paused(void) {
     return state.is_paused;
 }
 
 void gbs_audio_restart(void) {
-    gbs_audio_stop();
-
-    // Reset decoder state
-    state.block_index = 0;
-    state.byte_in_block = 0;
-    state.info.samples_decoded = 0;
-    state.info.is_finished = false;
-    state.current_block_ptr = state.gbs_data + GBS_HEADER_SIZE;
-
-    // Re-parse first block header
-    if (state.info.total_blocks > 0) {
-        if (state.info.channels == 2) {
-            parse_block_header_stereo(state.current_block_ptr);
-        } else {
-            parse_block_header_mono(state.current_block_ptr, &state.left);
-        }
-    }
+    gbs_audio_seek_sample(0);
+}
 
-    gbs_audio_start();
+void gbs_audio_set_loop(bool loop) {
+    state.loop = loop;
 }
 
 bool gbs_audio_is_playing(void) {
@@ -1135,77 +1908,76 @@ void gbs_audio_shutdown(void) {
     state.info.mode = GBS_MODE_INVALID;
 }
 
-void gbs_audio_seek_minute(uint32_t minute) {
-    if (state.info.mode == GBS_MODE_INVALID) return;
-
-    gbs_audio_stop();
-
-    // Calculate target block based on minute
-    // samples_per_minute = sample_rate * 60
-    uint32_t samples_per_minute = state.info.sample_rate * 60;
-    uint32_t target_sample = minute * samples_per_minute;
-
-    // Clamp to valid range
-    if (target_sample >= state.info.total_samples) {
-        target_sample = 0;  // Wrap to beginning
-        minute = 0;
-    }
-
-    // Calculate samples per block
-    uint32_t data_per_block = state.info.block_size - state.block_header_size;
-    uint32_t samples_per_block;
-
-    switch (state.info.mode) {
-        case GBS_MODE_STEREO_4BIT:
-            samples_per_block = data_per_block;
-            break;
-        case GBS_MODE_MONO_3BIT:
-            samples_per_block = (data_per_block / 3) * 8;
-            break;
-        case GBS_MODE_MONO_4BIT:
-            samples_per_block = data_per_block * 2;
-            break;
-        case GBS_MODE_MONO_2BIT:
-        case GBS_MODE_MONO_2BIT_SM:
-            samples_per_block = data_per_block * 4;
-            break;
-        default:
-            samples_per_block = 1;
-    }
-
-    // Calculate target block index
+// Move the decoder to target_sample: parse the containing block's header
+// (it resets predictor and step index), then skip to the sample in it
+static void seek_decoder(uint32_t target_sample) {
+    uint32_t samples_per_block = state.ops.samples_per_block;
     uint32_t target_block = target_sample / samples_per_block;
-    if (target_block >= state.info.total_blocks) {
-        target_block = 0;
-    }
+    uint32_t in_block = target_sample - target_block * samples_per_block;
 
     // Reset decoder state to target block
     state.block_index = target_block;
     state.byte_in_block = 0;
-    state.info.samples_decoded = target_block * samples_per_block;
+    state.info.samples_decoded = target_sample;
     state.info.is_finished = false;
     state.samples_buffered = 0;
     state.have_high_nibble = false;
-    state.current_block_ptr = state.gbs_data + GBS_HEADER_SIZE + target_block * state.info.block_size;
-
-    // Reset sync tracking for new position
-    // next_minute_sample = (minute + 1) * samples_per_minute
-    // Use addition loop to avoid multiplication
-    state.next_minute_sample = 0;
-    for (uint32_t i = 0; i <= minute; i++) {
-        state.next_minute_sample += state.samples_per_minute;
+    state.current_block_ptr = block_address(target_block);
+
+    // Parse block header, then skip to the target sample
+    state.ops.parse_header(state.current_block_ptr);
+    if (in_block > 0) {
+        state.ops.skip(in_block);
     }
-    state.current_audio_minute = minute;
-    state.sync_minute = -1;  // Clear any pending sync
+}
 
-    // Parse block header
-    if (state.info.channels == 2) {
-        parse_block_header_stereo(state.current_block_ptr);
-    } else {
-        parse_block_header_mono(state.current_block_ptr, &state.left);
+void gbs_audio_seek_sample(uint64_t sample) {
+    if (state.info.mode == GBS_MODE_INVALID) return;
+
+    // Clamp to valid range
+    if (sample >= state.info.total_samples) {
+        sample = 0;  // Wrap to beginning
+    }
+
+    if (!state.info.is_playing || state.is_paused) {
+        gbs_audio_stop();
+        seek_decoder((uint32_t)sample);
+        gbs_audio_start();
+        return;
+    }
+
+    // Playing: swap the decoder state under the running timers and DMA.
+    // The buffer on air plays out; the ones queued behind it are dropped
+    // and the ring refilled from the target, which starts at the next
+    // buffer boundary. Hold the decoder so the IRQ does not decode while
+    // it moves - the queued buffers cover the skip. Until then the clock
+    // reads the target: reporting the old position for up to a buffer
+    // would pull A/V sync back to where the seek came from.
+    state.producing = true;
+    seek_decoder((uint32_t)sample);
+
+    uint16_t ime = REG_IME;
+    REG_IME = 0;
+    state.seek_sample = (uint32_t)sample;
+    state.seek_loops = state.loops_decoded;
+    state.seek_pending = true;
+    state.buffers_decoded = state.buffers_played;
+    state.decode_slot = (state.play_buffer + 1 == AUDIO_BUFFER_COUNT) ? 0 : state.play_buffer + 1;
+    REG_IME = ime;
+
+    while (state.buffers_decoded - state.buffers_played < AUDIO_BUFFER_COUNT - 1 &&
+           !state.info.is_finished) {
+        produce_buffer();
     }
+    state.producing = false;
+}
 
-    gbs_audio_start();
+void gbs_audio_seek_ms(uint32_t ms) {
+    gbs_audio_seek_sample((uint64_t)ms * state.info.sample_rate / 1000);
+}
+
+void gbs_audio_seek_minute(uint32_t minute) {
+    gbs_audio_seek_sample((uint64_t)minute * state.samples_per_minute);
 }
 
 uint32_t gbs_audio_get_current_minute(void) {
@@ -1218,10 +1990,122 @@ uint32_t gbs_audio_get_total_minutes(void) {
     return (state.info.total_samples + state.info.sample_rate * 60 - 1) / (state.info.sample_rate * 60);
 }
 
-int32_t gbs_audio_check_minute_sync(void) {
-    int32_t minute = state.sync_minute;
-    if (minute >= 0) {
-        state.sync_minute = -1;  // Clear pending flag
+// Sample on air and the number of loops played before it
+static uint32_t read_play_clock(uint32_t* loops) {
+    // Read the base and TM1 as a pair: with IRQs off, an overflow that has
+    // happened but not been serviced shows as a pending IF bit, and the
+    // buffer after play_buffer (if one is queued) is the one playing
+    uint16_t ime = REG_IME;
+    REG_IME = 0;
+    uint32_t count = REG_TM1CNT_L;
+    uint32_t position = state.buffer_start_sample;
+    *loops = state.buffer_loops;
+    if (state.seek_pending &&
+        !((REG_IF & IRQ_TIMER1) && state.buffers_decoded != state.buffers_played)) {
+        // The buffer on air predates a live seek: hold at the target
+        position = state.seek_sample;
+        *loops = state.seek_loops;
+        REG_IME = ime;
+        return position;
+    }
+    bool held = state.replaying;
+    if (REG_IF & IRQ_TIMER1) {
+        count = REG_TM1CNT_L;
+        if (state.buffers_decoded != state.buffers_played) {
+            uint8_t next = (state.play_buffer + 1 == AUDIO_BUFFER_COUNT) ? 0 : state.play_buffer + 1;
+            position = state.slot_start_sample[next];
+            *loops = state.slot_loops[next];
+            held = false;
+        } else if (state.info.is_finished) {
+            position += state.info.buffer_samples;  // Drained: past the end
+            held = false;
+        } else {
+            held = true;                            // Underrun: replays
+        }
+    }
+    REG_IME = ime;
+
+    // TM1 counts Timer0 overflows (samples) up from its reload value. A
+    // replayed buffer would count its samples again, so the clock holds at
+    // the end of the buffer instead of stepping back and video with it.
+    if (held) {
+        position += state.info.buffer_samples;
+    } else {
+        position += (uint16_t)(count - (65536 - state.info.buffer_samples));
+    }
+
+    // The buffer that wraps plays on past the end into the next pass
+    if (position >= state.info.total_samples) {
+        if (state.loop) {
+            position -= state.info.total_samples;
+            (*loops)++;
+        } else {
+            position = state.info.total_samples;
+        }
+    }
+    return position;
+}
+
+uint32_t gbs_audio_get_position(void) {
+    if (state.info.mode == GBS_MODE_INVALID) return 0;
+
+    uint32_t loops;
+    return read_play_clock(&loops);
+}
+
+uint32_t gbs_audio_get_loop_count(void) {
+    if (state.info.mode == GBS_MODE_INVALID) return 0;
+
+    uint32_t loops;
+    read_play_clock(&loops);
+    return loops;
+}
+
+bool gbs_audio_get_stats(GbsAudioStats* out) {
+#if GBS_AUDIO_STATS
+    uint16_t ime = REG_IME;
+    REG_IME = 0;
+    *out = stats;
+    uint64_t total = stats_irq_cycles_total;
+    REG_IME = ime;
+
+    out->irq_cycles_mean = out->irq_count ? (uint32_t)(total / out->irq_count) : 0;
+    return true;
+#else
+    memset(out, 0, sizeof(*out));
+    return false;
+#endif
+}
+
+void gbs_audio_reset_stats(void) {
+#if GBS_AUDIO_STATS
+    uint16_t ime = REG_IME;
+    REG_IME = 0;
+    memset(&stats, 0, sizeof(stats));
+    stats_irq_cycles_total = 0;
+    REG_IME = ime;
+#endif
+}
+
+bool gbs_audio_save_stats(void) {
+#if GBS_AUDIO_STATS
+    GbsAudioStats snapshot;
+    gbs_audio_get_stats(&snapshot);
+
+    // SRAM has an 8-bit bus: byte writes only
+    volatile uint8_t* sram = (volatile uint8_t*)SRAM + GBS_STATS_SRAM_OFFSET;
+    const uint8_t* record = (const uint8_t*)&snapshot;
+    uint32_t size = sizeof(snapshot);
+
+    for (int i = 0; i < 4; i++) {
+        sram[i] = "GBST"[i];
+        sram[4 + i] = (uint8_t)(size >> (8 * i));
     }
-    return minute;
+    for (uint32_t i = 0; i < size; i++) {
+        sram[8 + i] = record[i];
+    }
+    return true;
+#else
+    return false;
+#endif
 }
@@ -5,11 +5,12 @@
  * Loads media files from GBFS filesystem.
  *
  * Features:
- * - 10 FPS video with frame rate control
- * - A/V sync every 600 frames (1 minute) at I-frames
+ * - 10 FPS video with frame rate control, decoding ahead into a frame queue
+ * - A/V sync against the audio clock every frame (drop/hold video frames)
  * - A button to pause/resume
  * - L/R buttons for seeking by minute
  * - START button to restart from beginning
+ * - 160x128 streams play in Mode 5 with page flipping, scaled to full screen
  */
 
 #include <gba.h>
@@ -51,38 +52,325 @@ static void copy_frame_to_vram(const void* src, void* dst, u32 size) {
     );
 }
 
-// EWRAM buffer for video frame (240 * 160 = 38400 pixels)
-__attribute__((section(".ewram"))) u16 frame_buffer[38400];
+// Same kernel at 16 bytes per iteration, for partial macroblock-row spans.
+// size must be a nonzero multiple of 16 (one 8-pixel macroblock row).
+__attribute__((target("arm"), noinline))
+static void copy_span_to_vram(const void* src, void* dst, u32 size) {
+    asm volatile(
+        "1:                         \n"
+        "   ldmia %[src]!, {r2-r5}  \n"
+        "   stmia %[dst]!, {r2-r5}  \n"
+        "   subs  %[size], %[size], #16 \n"
+        "   bgt   1b                \n"
+        : [src] "+r" (src), [dst] "+r" (dst), [size] "+r" (size)
+        :
+        : "r2", "r3", "r4", "r5", "memory", "cc"
+    );
+}
 
-// State
+// What is playing (the band decoder tops up the audio between rows)
 static bool has_video = false;
 static bool has_audio = false;
+
+// Video output path
+// 0: decode ahead into frame_queue, VIDEO_QUEUE_FRAMES whole frames in EWRAM
+//    (225 KB at the default 3), copy dirty blocks to VRAM at display time
+// 1: band mode - decode at display time, one macroblock row at a time, into
+//    two IWRAM bands that are streamed to VRAM. Frees the queue's EWRAM, but
+//    nothing is decoded ahead, so every frame must decode within its own
+//    display slot instead of borrowing time from the frames before it.
+// Streaming builds use band mode: EWRAM holds the stream cache instead.
+#ifndef VIDEO_BAND_DECODE
+#define VIDEO_BAND_DECODE MEDIA_SOURCE_STREAM
+#endif
+
+#if MEDIA_SOURCE_STREAM && !VIDEO_BAND_DECODE
+#error "MEDIA_SOURCE_STREAM needs VIDEO_BAND_DECODE: the frame queue and the stream cache do not both fit in EWRAM"
+#endif
+
+#define MB_ROW_BYTES    (8 * FRAME_WIDTH * 2)   // 3840 bytes, multiple of 128
+#define MB_SPAN_BYTES   (8 * 2)                 // one macroblock's pixel row
+#define LINE_BYTES      (FRAME_WIDTH * 2)
+
+// Copy the dirty macroblocks of one macroblock row (mask bit x = block x),
+// each run of dirty blocks line by line. src and dst have FRAME_WIDTH stride.
+static void copy_dirty_row_to_vram(const u8* src, u8* dst, u32 mask) {
+    u32 x_bytes = 0;
+    while (mask) {
+        // Skip clean blocks
+        while (!(mask & 1)) {
+            mask >>= 1;
+            x_bytes += MB_SPAN_BYTES;
+        }
+        // Measure the dirty run
+        u32 run_bytes = 0;
+        while (mask & 1) {
+            mask >>= 1;
+            run_bytes += MB_SPAN_BYTES;
+        }
+
+        const u8* s = src + x_bytes;
+        u8* d = dst + x_bytes;
+        for (int line = 0; line < 8; line++) {
+            copy_span_to_vram(s, d, run_bytes);
+            s += LINE_BYTES;
+            d += LINE_BYTES;
+        }
+        x_bytes += run_bytes;
+    }
+}
+
+#if VIDEO_BAND_DECODE
+
+// Two macroblock-row bands in IWRAM (2 * 3840 bytes). Row y decodes into
+// video_bands[y & 1]; references are read straight from VRAM.
+IWRAM_DATA static u16 video_bands[2][GBM_BAND_PIXELS] __attribute__((aligned(4)));
+static u16* const video_band_ptrs[2] = { video_bands[0], video_bands[1] };
+
+// Dirty mask of the band waiting to be written back
+static u32 pending_band_dirty;
+
+// Write the dirty macroblocks of band row y_block to VRAM
+static void write_band_to_vram(int y_block, u32 mask) {
+    const u8* src = (const u8*)video_bands[y_block & 1];
+    u8* dst = (u8*)0x06000000 + y_block * MB_ROW_BYTES;
+
+    if (mask == GBM_MB_ROW_FULL) {
+        copy_frame_to_vram(src, dst, MB_ROW_BYTES);
+    } else {
+        copy_dirty_row_to_vram(src, dst, mask);
+    }
+}
+
+// Row y is done: row y + 1 can still reference the old pixels of row y, so
+// write back the row before it. That frees its band for row y + 1.
+// The audio ring is topped up between rows too: a whole frame decode can
+// outlast the buffers queued at 44100 Hz.
+static void band_row_done(int y_block, u32 dirty) {
+    if (y_block > 0) {
+        write_band_to_vram(y_block - 1, pending_band_dirty);
+    }
+    pending_band_dirty = dirty;
+    if (has_audio) gbs_audio_update();
+}
+
+#else
+
+// Decoded-frame queue: a ring of whole frames in EWRAM. The main loop
+// decodes into it whenever it is ahead of target_frame and the display
+// drains it at the frame cadence, so one expensive frame is absorbed by
+// the frames decoded ahead of it. Three frames take 225 KB of the 256 KB.
+#ifndef VIDEO_QUEUE_FRAMES
+#define VIDEO_QUEUE_FRAMES 3
+#endif
+
+#define FRAME_PIXELS (FRAME_WIDTH * FRAME_HEIGHT)
+
+EWRAM_BSS static u16 frame_queue[VIDEO_QUEUE_FRAMES][FRAME_PIXELS];
+
+// Macroblocks each slot's decode wrote (bit x of entry y = block (x, y)).
+// Clean blocks match the frame before, so only dirty ones need copying.
+static u32 queue_dirty[VIDEO_QUEUE_FRAMES][GBM_MB_ROWS];
+
+static u32 queue_head = 0;          // Slot of the next frame to display
+static u32 queue_count = 0;         // Decoded frames not displayed yet
+static bool vram_needs_full = false; // VRAM is not the frame before queue_head
+
+// Macroblocks written by dropped frames, still to be copied to VRAM
+static u32 dropped_dirty[GBM_MB_ROWS];
+
+// Slot i places after queue_head
+static u32 queue_slot(u32 i) {
+    i += queue_head;
+    return i >= VIDEO_QUEUE_FRAMES ? i - VIDEO_QUEUE_FRAMES : i;
+}
+
+static void queue_reset(void) {
+    memset(frame_queue, 0, sizeof(frame_queue));
+    memset(queue_dirty, 0, sizeof(queue_dirty));
+    queue_head = 0;
+    queue_count = 0;
+    vram_needs_full = false;
+    memset(dropped_dirty, 0, sizeof(dropped_dirty));
+}
+
+// Drop the queued frames (seek). Decoding carries on after the newest
+// decoded frame; whatever comes next is not based on what VRAM shows.
+static void queue_flush(void) {
+    queue_head = queue_slot(queue_count);
+    queue_count = 0;
+    vram_needs_full = true;
+    memset(dropped_dirty, 0, sizeof(dropped_dirty));
+}
+
+// Copy the dirty macroblocks of a decoded frame to VRAM.
+// Runs of fully dirty rows are contiguous and go through the 128-byte kernel;
+// other rows copy each run of dirty blocks line by line.
+static void copy_dirty_to_vram(const u16* frame, const u32* dirty_rows) {
+    const u8* src = (const u8*)frame;
+    u8* dst = (u8*)0x06000000;
+    u32 y = 0;
+
+    while (y < GBM_MB_ROWS) {
+        u32 mask = dirty_rows[y];
+
+        if (mask == GBM_MB_ROW_FULL) {
+            u32 size = MB_ROW_BYTES;
+            y++;
+            while (y < GBM_MB_ROWS && dirty_rows[y] == GBM_MB_ROW_FULL) {
+                size += MB_ROW_BYTES;
+                y++;
+            }
+            copy_frame_to_vram(src, dst, size);
+            src += size;
+            dst += size;
+            continue;
+        }
+
+        copy_dirty_row_to_vram(src, dst, mask);
+        src += MB_ROW_BYTES;
+        dst += MB_ROW_BYTES;
+        y++;
+    }
+}
+
+// Decode the frame at offset into the free slot after the newest frame,
+// which is the reference. The slot still holds the frame decoded
+// VIDEO_QUEUE_FRAMES ago, so blocks written by any other slot's decode since
+// are stale. Returns the offset of the next frame.
+static u32 decode_into_queue(const u8* data, u32 offset) {
+    u32 slot = queue_slot(queue_count);
+    u32 ref = slot == 0 ? VIDEO_QUEUE_FRAMES - 1 : slot - 1;
+
+    u32 stale[GBM_MB_ROWS];
+    memset(stale, 0, sizeof(stale));
+    for (u32 i = 0; i < VIDEO_QUEUE_FRAMES; i++) {
+        if (i == slot) continue;
+        for (int y = 0; y < GBM_MB_ROWS; y++) {
+            stale[y] |= queue_dirty[i][y];
+        }
+    }
+
+    offset = gbm_decode_frame_paged(data, offset, frame_queue[slot],
+                                    frame_queue[ref], stale, queue_dirty[slot]);
+    queue_count++;
+    return offset;
+}
+
+// Show the oldest queued frame (only macroblocks that changed, including
+// those of frames dropped since the last one shown)
+static void display_queued_frame(void) {
+    if (vram_needs_full) {
+        copy_frame_to_vram(frame_queue[queue_head], (void*)0x06000000, FRAME_PIXELS * 2);
+        vram_needs_full = false;
+    } else {
+        u32 dirty[GBM_MB_ROWS];
+        for (int y = 0; y < GBM_MB_ROWS; y++) {
+            dirty[y] = queue_dirty[queue_head][y] | dropped_dirty[y];
+        }
+        copy_dirty_to_vram(frame_queue[queue_head], dirty);
+    }
+    memset(dropped_dirty, 0, sizeof(dropped_dirty));
+    queue_head = queue_slot(1);
+    queue_count--;
+}
+
+// Skip the oldest queued frame without showing it
+static void drop_queued_frame(void) {
+    for (int y = 0; y < GBM_MB_ROWS; y++) {
+        dropped_dirty[y] |= queue_dirty[queue_head][y];
+    }
+    queue_head = queue_slot(1);
+    queue_count--;
+}
+
+#endif
+
+// Mode 5 page-flip path, used for 160x128 (GBM_M5_WIDTH x GBM_M5_HEIGHT)
+// streams: the next frame is decoded straight into the back page and shown
+// by flipping DISPCNT's page bit at VBlank, so nothing is copied.
+#define DISPCNT_PAGE    0x0010                  // Mode 4/5: show page 1
+#define M5_PAGE_BYTES   0xA000                  // 160 * 128 * 2
+
+static bool video_mode5 = false;
+static int front_page = 0;
+
+// Macroblocks each page's last decode wrote. The page shown differs from
+// the back page exactly there, so they are the next decode's stale blocks.
+static u32 page_dirty[2][GBM_MB_ROWS];
+
+static u16* mode5_page(int page) {
+    return (u16*)(0x06000000 + page * M5_PAGE_BYTES);
+}
+
+// Show the back page at VBlank. A frame that is already late arrives here
+// mid-scan, so wait for the next VBlank rather than tear the picture.
+static void flip_pages(void) {
+    if (REG_VCOUNT < SCREEN_HEIGHT) {
+        VBlankIntrWait();
+    }
+    front_page ^= 1;
+    REG_DISPCNT ^= DISPCNT_PAGE;
+}
+
+// State
 static const uint8_t* video_data = NULL;
 static uint32_t video_offset = GBM_HEADER_SIZE;
 static uint32_t video_size = 0;
 
+#if MEDIA_SOURCE_STREAM
+// The media on the block device (video_data is NULL)
+static MediaStream video_stream;
+static MediaStream audio_stream;
+#endif
+
+// Length of the frame at offset, from its u16 header
+static u32 frame_length(u32 offset) {
+#if MEDIA_SOURCE_STREAM
+    u8 len[2];
+    if (!media_stream_read(video_stream.start + offset, len, 2)) return 0;
+    return len[0] | (len[1] << 8);
+#else
+    return video_data[offset] | (video_data[offset + 1] << 8);
+#endif
+}
+
 // Frame rate control
 // Video is 10 FPS, VBlank is 60 Hz, so 1 frame = 6 VBlanks
+#define VIDEO_FPS 10
 #define VBLANKS_PER_FRAME 6
 
 // I-frame interval: 600 frames = 1 minute at 10 FPS
 #define FRAMES_PER_MINUTE 600
 
-// target_frame: incremented by VBlank ISR, represents "should have displayed this many frames"
-// current_frame: maintained by main loop, represents "have decoded this many frames"
+// target_frame: represents "should have displayed this many frames" - follows
+//               the audio clock when there is audio, else counted by the VBlank ISR
+// current_frame: maintained by main loop, represents "have displayed this many frames"
 static volatile u32 target_frame = 0;
 static u32 current_frame = 0;
 
+// Audio-master clock: with audio playing, target_frame is derived from the
+// audio position every frame, so video drops or holds frames to stay on it
+// and never drifts away from the sound
+static bool audio_clock = false;
+
+// Further behind the audio clock than this, jump to the I-frame of the
+// clock's minute instead of decoding every frame up to it
+#define RESYNC_FRAMES (VIDEO_FPS * 5)
+
 // For tracking current minute (for sync and seeking)
 static u32 current_minute = 0;
 
+// Audio loops seen so far; video restarts when the audio comes round
+static u32 audio_loops = 0;
+
 // Pause state
 static bool is_paused = false;
 
 static void vblank_handler(void) {
     // Called at 60 Hz, increment target_frame every 6 VBlanks (10 FPS)
-    // Don't increment when paused
-    if (is_paused) return;
+    // Don't increment when paused, or when the audio clock drives video
+    if (is_paused || audio_clock) return;
 
     static u8 vblank_counter = 0;
     vblank_counter++;
@@ -92,6 +380,112 @@ static void vblank_handler(void) {
     }
 }
 
+// I-frame offsets (one per minute): mapped from the packager's frame index
+// in ROM when there is one, else built into iframe_table as the video is
+// scanned - lazily, so the first frame shows at once whatever the length
+// Maximum 256 minutes (~4 hours) when scanned
+#define MAX_MINUTES 256
+static u32 iframe_table[MAX_MINUTES];
+static const u32* iframe_offsets = iframe_table;
+static u32 total_minutes = 0;       // Minutes indexed so far
+
+// Scan cursor: the first frame not yet indexed. Decoding steps it on for
+// free when it plays that frame; idle VBlank waits scan ahead of it.
+static u32 scan_offset = GBM_HEADER_SIZE;
+static u32 scan_minute_frame = 0;   // Frames since the cursor's minute began
+static bool scan_done = false;
+
+// Frame headers scanned per idle VBlank wait (a few ROM reads each)
+#define INDEX_SCAN_FRAMES 256
+
+// Map the frame index the catalog found next to the video (see
+// GbmIndexHeader). Returns false if there is none, its keyframes are not
+// the minutes this player seeks by, or any keyframe lies outside the video
+// frames - seeking would then read past the end of the video.
+static bool load_frame_index(const MediaEntry* video) {
+    const GbmIndexHeader* header = (const GbmIndexHeader*)video->index;
+    if (!header || header->keyframe_interval != FRAMES_PER_MINUTE ||
+        header->keyframe_count == 0) {
+        return false;
+    }
+
+    const u32* offsets = (const u32*)(header + 1);
+    for (u32 i = 0; i < header->keyframe_count; i++) {
+        if (offsets[i] < GBM_HEADER_SIZE || offsets[i] >= video_size) {
+            return false;
+        }
+    }
+
+    iframe_offsets = offsets;
+    total_minutes = header->keyframe_count;
+    scan_done = true;
+    return true;
+}
+
+// Index the frame at the scan cursor, frame_len bytes long, and step over it
+static void index_frame(u32 frame_len) {
+    if (scan_minute_frame == 0) {
+        if (total_minutes == MAX_MINUTES) {
+            scan_done = true;
+            return;
+        }
+        iframe_table[total_minutes++] = scan_offset;
+    }
+    scan_offset += 2 + frame_len;
+    if (++scan_minute_frame == FRAMES_PER_MINUTE) {
+        scan_minute_frame = 0;
+    }
+}
+
+// Scan up to max_frames frame headers ahead of the cursor
+static void index_scan(u32 max_frames) {
+    while (!scan_done && max_frames-- > 0) {
+        if (scan_offset + 2 >= video_size) {
+            scan_done = true;
+            break;
+        }
+        u32 frame_len = frame_length(scan_offset);
+        if (frame_len == 0 || frame_len == 0xFFFF) {
+            scan_done = true;
+            break;
+        }
+        index_frame(frame_len);
+    }
+}
+
+// Whether minute can be sought to, scanning on up to it if need be
+static bool index_has_minute(u32 minute) {
+    while (minute >= total_minutes && !scan_done) {
+        index_scan(FRAMES_PER_MINUTE);
+    }
+    return minute < total_minutes;
+}
+
+// Idle until the next VBlank, topping up the audio ring and growing the
+// I-frame index first. Streaming builds read ahead instead: scanning would
+// pull the whole video through the cache.
+static void wait_vblank(void) {
+    if (has_audio) gbs_audio_update();
+#if MEDIA_SOURCE_STREAM
+    media_stream_prefetch();
+#else
+    if (has_video) index_scan(INDEX_SCAN_FRAMES);
+#endif
+    VBlankIntrWait();
+}
+
+// Recompute target_frame from the audio position (audio clock only).
+// Frame n is due once the audio has played n / VIDEO_FPS seconds.
+static void update_target_frame(void) {
+    if (!audio_clock) return;
+
+    u32 position = gbs_audio_get_position();
+    u32 rate = gbs_audio_get_info()->sample_rate;
+    u32 seconds = position / rate;
+    u32 frame = seconds * VIDEO_FPS + (position - seconds * rate) * VIDEO_FPS / rate;
+    target_frame = frame + 1;
+}
+
 static void show_error(const char* msg) {
     consoleDemoInit();
     iprintf("\x1b[2J");
@@ -124,11 +518,34 @@ static void show_info(void) {
 }
 
 static void init_video_display(void) {
+    if (video_mode5) {
+        // Mode 5: two 160x128 pages, BG2 affine-scaled to 240x160
+        // (8.8 fixed point source step per screen pixel: 160/240, 128/160)
+        SetMode(MODE_5 | BG2_ENABLE);
+        REG_BG2PA = (GBM_M5_WIDTH << 8) / FRAME_WIDTH;
+        REG_BG2PB = 0;
+        REG_BG2PC = 0;
+        REG_BG2PD = (GBM_M5_HEIGHT << 8) / FRAME_HEIGHT;
+        REG_BG2X = 0;
+        REG_BG2Y = 0;
+
+        // Clear both pages; they match, so nothing is stale
+        u16* vram = mode5_page(0);
+        for (int i = 0; i < 2 * M5_PAGE_BYTES / 2; i++) {
+            vram[i] = 0;
+        }
+        memset(page_dirty, 0, sizeof(page_dirty));
+        front_page = 0;
+        return;
+    }
+
     // Mode 3: 240x160, 15-bit color
     SetMode(MODE_3 | BG2_ENABLE);
 
+#if !VIDEO_BAND_DECODE
     // Clear buffers
-    memset(frame_buffer, 0, sizeof(frame_buffer));
+    queue_reset();
+#endif
 
     // Clear VRAM
     u16* vram = (u16*)0x06000000;
@@ -137,42 +554,10 @@ static void init_video_display(void) {
     }
 }
 
-// Pre-calculated I-frame offsets (one per minute)
-// Maximum 256 minutes (~4 hours) should be enough
-#define MAX_MINUTES 256
-static u32 iframe_offsets[MAX_MINUTES];
-static u32 total_minutes = 0;
-
-// Scan video to find I-frame offsets (every 600 frames)
-static void scan_iframe_offsets(void) {
-    if (!has_video || !video_data) return;
-
-    u32 offset = GBM_HEADER_SIZE;
-    u32 frame_count = 0;
-    u32 minute = 0;
-
-    while (offset + 2 < video_size && minute < MAX_MINUTES) {
-        // Record offset at start of each minute (every 600 frames)
-        if (frame_count % FRAMES_PER_MINUTE == 0) {
-            iframe_offsets[minute] = offset;
-            minute++;
-        }
-
-        // Read frame length and skip to next frame
-        uint16_t frame_len = video_data[offset] | (video_data[offset + 1] << 8);
-        if (frame_len == 0 || frame_len == 0xFFFF) break;
-
-        offset = offset + 2 + frame_len;
-        frame_count++;
-    }
-
-    total_minutes = minute;
-}
-
 // Seek video to a specific minute (jumps to I-frame)
 // I-frame will fully redraw the screen, no need to clear VRAM
 static void video_seek_minute(u32 minute) {
-    if (!has_video || minute >= total_minutes) return;
+    if (!has_video || !index_has_minute(minute)) return;
 
     video_offset = iframe_offsets[minute];
     current_minute = minute;
@@ -184,11 +569,18 @@ static void video_seek_minute(u32 minute) {
         current_frame += FRAMES_PER_MINUTE;
     }
     target_frame = current_frame;
+
+#if !VIDEO_BAND_DECODE
+    // Queued frames are from before the seek
+    if (!video_mode5) {
+        queue_flush();
+    }
+#endif
 }
 
 // Seek both audio and video to a specific minute
 static void seek_to_minute(u32 minute) {
-    if (minute >= total_minutes && total_minutes > 0) {
+    if (!index_has_minute(minute) && total_minutes > 0) {
         minute = total_minutes - 1;
     }
 
@@ -216,16 +608,26 @@ static void toggle_pause(void) {
         is_paused = true;
         if (has_audio) {
             gbs_audio_pause();
+            gbs_audio_save_stats();     // Telemetry builds: keep a snapshot in SRAM
         }
     }
 }
 
-// Decode next frame into frame_buffer (does not display)
-static void decode_next_frame(void) {
-    if (!has_video || !video_data) return;
+// Decode next frame into the frame queue or the Mode 5 back page (does not
+// display). In band mode the frame goes straight to VRAM as it is decoded.
+// returns false if nothing was decoded: the video has ended and the queue
+// must drain before it loops
+static bool decode_next_frame(void) {
+    if (!has_video) return false;
 
     // Check for end of video
     if (video_offset + 2 >= video_size) {
+        // Audio clock: hold the last frame until the audio loops
+        if (audio_clock) return false;
+#if !VIDEO_BAND_DECODE
+        // Counters restart with the loop, so show the last frames first
+        if (queue_count > 0) return false;
+#endif
         // Loop video
         video_offset = GBM_HEADER_SIZE;
         current_frame = 0;
@@ -234,29 +636,73 @@ static void decode_next_frame(void) {
     }
 
     // Read frame length
-    uint16_t frame_len = video_data[video_offset] | (video_data[video_offset + 1] << 8);
+    u32 frame_len = frame_length(video_offset);
 
     // Check for invalid frame
     if (frame_len == 0 || frame_len == 0xFFFF) {
+        if (audio_clock) return false;
+#if !VIDEO_BAND_DECODE
+        if (queue_count > 0) return false;
+#endif
         video_offset = GBM_HEADER_SIZE;
         current_frame = 0;
         target_frame = 0;
         current_minute = 0;
-        frame_len = video_data[video_offset] | (video_data[video_offset + 1] << 8);
+        frame_len = frame_length(video_offset);
+    }
+
+    // Playing the frame at the scan cursor indexes it for free
+    if (!scan_done && video_offset == scan_offset) {
+        index_frame(frame_len);
+    }
+
+    // The frame's bytes: in place in ROM, or staged from the stream. The
+    // decoders return the offset after the frame in data.
+    const u8* data = video_data;
+    u32 offset = video_offset;
+#if MEDIA_SOURCE_STREAM
+    data = media_stream_stage_frame(&video_stream, video_offset);
+    offset = 0;
+    if (!data) return false;
+#endif
+
+    if (video_mode5) {
+        // Decode frame (dst = back page, ref = front page)
+        int back = front_page ^ 1;
+        video_offset += gbm_decode_frame_paged(data, offset, mode5_page(back),
+                                               mode5_page(front_page), page_dirty[front_page],
+                                               page_dirty[back]) - offset;
+        return true;
     }
 
-    // Decode frame (dst = EWRAM buffer, ref = VRAM for delta)
-    video_offset = gbm_decode_frame(video_data, video_offset, frame_buffer, (const u16*)0x06000000);
+#if VIDEO_BAND_DECODE
+    // Decode frame (dst = IWRAM bands, ref = VRAM), then write the last band
+    video_offset += gbm_decode_frame_banded(data, offset, video_band_ptrs,
+                                            (const u16*)0x06000000, band_row_done) - offset;
+    write_band_to_vram(GBM_MB_ROWS - 1, pending_band_dirty);
+#else
+    // Decode frame (dst = free queue slot, ref = newest queued frame)
+    video_offset += decode_into_queue(data, offset) - offset;
+#endif
+    return true;
 }
 
-// Check if audio triggered a sync point (called from main loop)
-static void check_audio_sync(void) {
-    if (!has_audio) return;
+// Far behind the audio clock (e.g. decoding could not keep up): jump to the
+// I-frame of the clock's minute if that is ahead of the video
+static void check_clock_resync(void) {
+    if (!audio_clock || target_frame < current_frame + RESYNC_FRAMES) return;
 
-    int32_t sync_minute = gbs_audio_check_minute_sync();
-    if (sync_minute >= 0 && (u32)sync_minute < total_minutes) {
-        // Audio reached a new minute, force video to sync
-        video_seek_minute((u32)sync_minute);
+    // Minute of the due frame (using subtraction loop instead of division)
+    u32 frame = target_frame - 1;
+    u32 minute = 0;
+    while (frame >= FRAMES_PER_MINUTE) {
+        frame -= FRAMES_PER_MINUTE;
+        minute++;
+    }
+
+    if (minute > current_minute && index_has_minute(minute)) {
+        video_seek_minute(minute);
+        update_target_frame();
     }
 }
 
@@ -282,7 +728,7 @@ static bool handle_input(void) {
     // R: skip forward 1 minute
     if (keys & KEY_R) {
         u32 next_minute = current_minute + 1;
-        if (next_minute < total_minutes) {
+        if (index_has_minute(next_minute)) {
             seek_to_minute(next_minute);
         }
     }
@@ -299,21 +745,8 @@ static bool handle_input(void) {
     return false;
 }
 
-// Process video frames with frame rate control
-// Flow: decode -> wait for timing -> display -> repeat
-static void process_video(void) {
-    // Decode next frame first (into frame_buffer)
-    decode_next_frame();
-
-    // Wait until it's time to display
-    // Also check input during wait so pause can be toggled
-    while (current_frame >= target_frame) {
-        VBlankIntrWait();
-        handle_input();
-    }
-
-    // Display the pre-decoded frame
-    copy_frame_to_vram(frame_buffer, (void*)0x06000000, 240 * 160 * 2);
+// A frame was shown: advance current_frame and current_minute
+static void frame_displayed(void) {
     current_frame++;
 
     // Update current minute (using subtraction loop instead of division)
@@ -325,6 +758,86 @@ static void process_video(void) {
     }
 }
 
+// Whether the audio has looped since the main loop last rewound the video.
+// Its position is then back near 0, so no frame will come due until the
+// video is rewound to match.
+static bool audio_looped(void) {
+    return audio_clock && gbs_audio_get_loop_count() != audio_loops;
+}
+
+// Wait until it's time to display
+// Also check input during wait so pause can be toggled
+// Returns false if the audio looped while waiting: the main loop must
+// rewind the video before any frame is due again
+static bool wait_for_frame_time(void) {
+    update_target_frame();
+    while (current_frame >= target_frame) {
+        if (audio_looped()) return false;
+        wait_vblank();
+        handle_input();
+        update_target_frame();
+    }
+    return true;
+}
+
+// Process video frames with frame rate control
+// Mode 5: decode into back page -> wait for timing -> flip -> repeat
+// Mode 3: one step per call - decode if behind, else show the newest due
+//         queued frame (dropping older due ones), else decode ahead if the
+//         queue has room, else wait for VBlank
+//         (band mode: wait for timing -> decode straight to VRAM -> repeat)
+// Behind the clock, Mode 5 and band mode catch up by not waiting.
+static void process_video(void) {
+    update_target_frame();
+    check_clock_resync();
+
+    if (video_mode5) {
+        if (!decode_next_frame()) {
+            wait_vblank();
+            handle_input();
+            return;
+        }
+        // The back page holds the next frame in order, so it is shown even
+        // when the audio has looped; the main loop then rewinds the video
+        wait_for_frame_time();
+        flip_pages();
+        frame_displayed();
+        return;
+    }
+
+#if VIDEO_BAND_DECODE
+    if (!wait_for_frame_time()) return;
+    // Bands are written over the frame on screen, so decode only now
+    if (decode_next_frame()) {
+        frame_displayed();
+    } else {
+        wait_vblank();
+        handle_input();
+    }
+#else
+    u32 due = target_frame > current_frame ? target_frame - current_frame : 0;
+
+    if (due > queue_count && queue_count < VIDEO_QUEUE_FRAMES && decode_next_frame()) {
+        // Behind: decode the due frames before showing any
+    } else if (due > 0 && queue_count > 0) {
+        // Show the newest due frame; older due ones are dropped
+        while (due > 1 && queue_count > 1) {
+            drop_queued_frame();
+            frame_displayed();
+            due--;
+        }
+        display_queued_frame();
+        frame_displayed();
+    } else if (queue_count < VIDEO_QUEUE_FRAMES && decode_next_frame()) {
+        // Decoded ahead
+    } else {
+        // Queue full (or draining at the end of the video)
+        wait_vblank();
+        handle_input();
+    }
+#endif
+}
+
 int main(void) {
     // Initialize interrupts
     irqInit();
@@ -332,34 +845,51 @@ int main(void) {
     irqEnable(IRQ_VBLANK);
 
     // Initialize media source
-    if (!media_source_init()) {
+#if MEDIA_SOURCE_STREAM
+    // Streamed through the block cache: from the cart's SD card once a
+    // driver supplies its MediaBlockDevice, until then the archive in ROM
+    bool media_found = media_source_init_device(media_source_rom_device());
+#else
+    bool media_found = media_source_init();
+#endif
+    if (!media_found) {
         show_error("No GBFS found!\nAppend media with GBFS.");
     }
 
-    // Try to load video
-    MediaSourceInfo video_info;
-    if (media_source_find_gbm(&video_info)) {
-        // Validate GBM header
-        if (video_info.size >= GBM_HEADER_SIZE &&
-            video_info.data[0] == 'G' && video_info.data[1] == 'B' &&
-            video_info.data[2] == 'A' && video_info.data[3] == 'M') {
+    // Try to load video: the first GBM in the catalog (header checked there)
+    const MediaEntry* video = media_source_get_entry(MEDIA_TYPE_GBM, 0);
+    if (video) {
+        // 240x160 plays in Mode 3, 160x128 in Mode 5; nothing else fits
+        video_mode5 = video->width == GBM_M5_WIDTH && video->height == GBM_M5_HEIGHT;
+        if (video_mode5 || (video->width == FRAME_WIDTH && video->height == FRAME_HEIGHT)) {
             has_video = true;
-            video_data = video_info.data;
-            video_size = video_info.size;
+            video_data = video->data;
+            video_size = video->size;
             // Set decoder version based on header (offset 0x10)
             // Gen1 = 0x06, Gen3 = 0x05
-            gbm_set_version(video_info.data[0x10]);
+            gbm_set_version(video->gbm_version);
+            gbm_set_frame_size(video->width, video->height);
         }
     }
 
     // Try to load audio
-    MediaSourceInfo audio_info;
-    if (media_source_find_gbs(&audio_info)) {
-        if (gbs_audio_init(audio_info.data, audio_info.size)) {
-            has_audio = true;
-        }
+    const MediaEntry* audio = media_source_get_entry(MEDIA_TYPE_GBS, 0);
+#if MEDIA_SOURCE_STREAM
+    has_audio = audio && media_stream_open_gbs(&audio_stream, audio->offset, audio->size);
+#else
+    has_audio = audio && gbs_audio_init(audio->data, audio->size);
+#endif
+    if (has_audio) {
+        gbs_audio_set_loop(true);  // Loop the whole movie without a gap
     }
 
+#if MEDIA_SOURCE_STREAM
+    // Opened after the audio, which is read ahead first: it cannot wait
+    if (has_video) {
+        media_stream_open(&video_stream, video->offset, video->size);
+    }
+#endif
+
     // Must have at least one media type
     if (!has_video && !has_audio) {
         show_error("No media files found!\nAdd .gbm or .gbs files.");
@@ -377,13 +907,18 @@ int main(void) {
     // Start playback
     if (has_video) {
         init_video_display();
-        scan_iframe_offsets();  // Build I-frame offset table for seeking
+        // I-frame offset table for seeking: the packager's index, or
+        // built as the video plays (see index_scan)
+        load_frame_index(video);
     }
 
     if (has_audio) {
         gbs_audio_start();
     }
 
+    // With both, the audio position is the clock video follows
+    audio_clock = has_video && has_audio && gbs_audio_is_playing();
+
     // Reset frame counters
     target_frame = 0;
     current_frame = 0;
@@ -391,24 +926,27 @@ int main(void) {
 
     // Main loop
     while (1) {
-        // Check for audio-driven sync (audio reached a minute boundary)
-        if (has_video) {
-            check_audio_sync();
-        }
-
         if (has_video) {
             process_video();
         } else {
             // Audio only - just wait for VBlank and handle input
-            VBlankIntrWait();
+            wait_vblank();
             handle_input();
         }
 
-        // Handle audio looping
-        if (has_audio && gbs_audio_is_finished()) {
-            gbs_audio_restart();
-            if (has_video) {
-                seek_to_minute(0);  // Sync video when audio loops
+        if (has_audio) {
+            gbs_audio_update();
+        }
+
+        // Audio loops on its own; bring video back to the start with it
+        if (has_audio) {
+            u32 loops = gbs_audio_get_loop_count();
+            if (loops != audio_loops) {
+                audio_loops = loops;
+                gbs_audio_save_stats();
+                if (has_video) {
+                    video_seek_minute(0);
+                }
             }
         }
     }
@@ -1,13 +1,33 @@
 /*
  * Media Source Implementation
  *
- * Provides media data (GBS audio, GBM video) from GBFS or embedded data.
+ * Provides media data (GBS audio, GBM video) from GBFS or embedded data,
+ * or in streaming builds from a GBFS archive on a block device.
  */
 
 #include "media_source.h"
+#include "media_stream.h"
+#include "gbm_decoder.h"
+#include "gbs_audio.h"
 #include "../gbfs/gbfs.h"
+#include <gba_base.h>
 #include <string.h>
 
+// Archive locator: gbm_packager and build_with_gbfs.sh find this tag in
+// the player ROM and patch in the offset of the GBFS archive they append,
+// so init need not probe up to 32 MB of ROM for it. 0: not patched, scan.
+// volatile: the offset is only known once the ROM is built.
+typedef struct {
+    char tag[8];            // "GBFS@ROM", no terminator
+    u32 offset;             // From the start of ROM (0x08000000)
+} GbfsLocator;
+
+__attribute__((used, aligned(4)))
+static const volatile GbfsLocator gbfs_locator = { "GBFS@ROM", 0 };
+
+#define ROM_START   0x08000000
+#define ROM_LIMIT   0x02000000  // 32 MB
+
 // Internal state
 static struct {
     bool initialized;
@@ -15,8 +35,14 @@ static struct {
     const GBFS_FILE* gbfs;
     uint32_t gbs_count;
     uint32_t gbm_count;
+    uint8_t gbs_list[MEDIA_CATALOG_MAX];    // Catalog indices by type
+    uint8_t gbm_list[MEDIA_CATALOG_MAX];
 } source_state;
 
+// The catalog, in archive order (EWRAM: IWRAM is kept for code and audio)
+EWRAM_BSS static MediaEntry catalog[MEDIA_CATALOG_MAX];
+static uint32_t catalog_count;
+
 // Check file extension
 static bool has_extension(const char* name, const char* ext) {
     size_t name_len = strlen(name);
@@ -52,25 +78,106 @@ static MediaFileType get_file_type(const char* name) {
     return MEDIA_TYPE_UNKNOWN;
 }
 
+// Whether file starts with the GBFS magic (word aligned). It is matched in
+// two parts, as in libgbfs, so this code cannot match itself.
+static bool is_gbfs(const GBFS_FILE* file) {
+    return *(const u32*)file == 0x456e6950 &&   // "PinE"
+           memcmp(file->magic + 4, "ightGBFS\r\n\x1a\n", 12) == 0;
+}
+
+// The archive the locator points at, if it holds one
+static const GBFS_FILE* locate_gbfs(void) {
+    u32 offset = gbfs_locator.offset;
+    if (offset == 0 || offset >= ROM_LIMIT || (offset & 3)) return NULL;
+
+    const GBFS_FILE* file = (const GBFS_FILE*)(ROM_START + offset);
+    return is_gbfs(file) ? file : NULL;
+}
+
+// Whether an index's keyframe table fits in its len bytes. The count comes
+// from the file: bound it by the words there are before multiplying, or a
+// corrupt one wraps the size in 32 bits and passes.
+static bool keyframe_table_fits(const GbmIndexHeader* header, u32 len) {
+    return header->keyframe_count <= (len - sizeof(GbmIndexHeader)) / 4;
+}
+
+// The frame index stored next to a video ("movie.gbi" for "movie.gbm"),
+// if there is one and it was made from this video
+static void catalog_frame_index(MediaEntry* entry) {
+    char name[sizeof(entry->name)];
+    strcpy(name, entry->name);
+    strcpy(name + strlen(name) - 3, "gbi");
+
+    u32 len;
+    const GbmIndexHeader* header = gbfs_get_obj(source_state.gbfs, name, &len);
+    if (!header || len < sizeof(GbmIndexHeader) || ((u32)header & 3) ||
+        header->magic != GBM_INDEX_MAGIC || header->version != GBM_INDEX_VERSION ||
+        header->gbm_size != entry->size || !keyframe_table_fits(header, len)) {
+        return;
+    }
+
+    entry->index = (const uint8_t*)header;
+    entry->index_size = len;
+    entry->frame_count = header->frame_count;
+}
+
+// Fill in a video's metadata from its header; false if it is not a GBM
+static bool catalog_gbm(MediaEntry* entry, const uint8_t* header) {
+    if (entry->size < GBM_HEADER_SIZE ||
+        header[0] != 'G' || header[1] != 'B' || header[2] != 'A' || header[3] != 'M') {
+        return false;
+    }
+
+    entry->gbm_version = header[0x10];
+    entry->frame_rate = GBM_FRAME_RATE;
+    gbm_get_frame_size(header, &entry->width, &entry->height);
+    return true;
+}
+
+// Fill in an audio file's metadata from its header; false if it is not
+// playable GBS
+static bool catalog_gbs(MediaEntry* entry, const uint8_t* header) {
+    GbsAudioInfo info;
+    if (!gbs_audio_probe(header, entry->size, &info)) {
+        return false;
+    }
+
+    entry->gbs_mode = info.mode;
+    entry->channels = info.channels;
+    entry->sample_rate = info.sample_rate;
+    entry->duration_ms = (uint32_t)((uint64_t)info.total_samples * 1000 / info.sample_rate);
+    return true;
+}
+
 bool media_source_init(void) {
     memset(&source_state, 0, sizeof(source_state));
+    catalog_count = 0;
 
-    // Try to find GBFS archive
-    source_state.gbfs = find_first_gbfs_file(find_first_gbfs_file);
+    // Find the GBFS archive: where the packager recorded it, else scan
+    source_state.gbfs = locate_gbfs();
+    if (!source_state.gbfs) {
+        source_state.gbfs = find_first_gbfs_file(find_first_gbfs_file);
+    }
 
     if (source_state.gbfs) {
-        // Count GBS and GBM files in GBFS
+        // Catalog the GBS and GBM files in GBFS
         size_t total = gbfs_count_objs(source_state.gbfs);
 
-        for (size_t i = 0; i < total; i++) {
-            char name[32];
+        for (size_t i = 0; i < total && catalog_count < MEDIA_CATALOG_MAX; i++) {
+            MediaEntry* entry = &catalog[catalog_count];
+            memset(entry, 0, sizeof(*entry));
+
             u32 len;
-            if (gbfs_get_nth_obj(source_state.gbfs, i, name, &len)) {
-                if (is_gbs_file(name)) {
-                    source_state.gbs_count++;
-                } else if (is_gbm_file(name)) {
-                    source_state.gbm_count++;
-                }
+            entry->data = gbfs_get_nth_obj(source_state.gbfs, i, entry->name, &len);
+            entry->size = len;
+            entry->type = get_file_type(entry->name);
+            if (!entry->data) continue;
+
+            if (entry->type == MEDIA_TYPE_GBS && catalog_gbs(entry, entry->data)) {
+                source_state.gbs_list[source_state.gbs_count++] = catalog_count++;
+            } else if (entry->type == MEDIA_TYPE_GBM && catalog_gbm(entry, entry->data)) {
+                catalog_frame_index(entry);
+                source_state.gbm_list[source_state.gbm_count++] = catalog_count++;
             }
         }
 
@@ -83,64 +190,166 @@ bool media_source_init(void) {
     return (source_state.active_type != MEDIA_SOURCE_NONE);
 }
 
-bool media_source_find_gbs(MediaSourceInfo* info) {
-    if (!source_state.initialized || !info) {
-        return false;
+#if MEDIA_SOURCE_STREAM
+// ============================================================================
+// Block Device
+// ============================================================================
+
+// Frame indexes of streamed videos, copied out of the device: header and
+// keyframe table only (a keyframe per minute: 4 bytes a minute)
+#define DEVICE_INDEX_BYTES 4096
+EWRAM_BSS static u32 device_index[DEVICE_INDEX_BYTES / 4];
+static uint32_t device_index_used;     // In words
+
+// Directory entry n of the archive on the device
+static bool device_dir_entry(const GBFS_FILE* header, uint32_t n, GBFS_ENTRY* entry) {
+    return media_stream_read(header->dir_off + n * sizeof(GBFS_ENTRY), entry, sizeof(*entry)) &&
+           entry->data_offset <= header->total_len &&
+           entry->len <= header->total_len - entry->data_offset;
+}
+
+// The frame index next to a streamed video, copied to device_index if it
+// is one for this video and there is room
+static void device_frame_index(MediaEntry* entry, const GBFS_FILE* header) {
+    char name[sizeof(entry->name)];
+    strcpy(name, entry->name);
+    strcpy(name + strlen(name) - 3, "gbi");
+
+    for (uint32_t i = 0; i < header->dir_nmemb; i++) {
+        GBFS_ENTRY file;
+        if (!device_dir_entry(header, i, &file) || strncmp(file.name, name, sizeof(file.name)) != 0) {
+            continue;
+        }
+
+        GbmIndexHeader* index = (GbmIndexHeader*)(device_index + device_index_used);
+        uint32_t room = sizeof(device_index) - device_index_used * 4;
+        if (file.len < sizeof(GbmIndexHeader) || room < sizeof(GbmIndexHeader) ||
+            !media_stream_read(file.data_offset, index, sizeof(GbmIndexHeader)) ||
+            index->magic != GBM_INDEX_MAGIC || index->version != GBM_INDEX_VERSION ||
+            index->gbm_size != entry->size ||
+            !keyframe_table_fits(index, file.len) ||
+            room < sizeof(GbmIndexHeader) + 4 * index->keyframe_count ||
+            !media_stream_read(file.data_offset + sizeof(GbmIndexHeader), index + 1,
+                               4 * index->keyframe_count)) {
+            return;
+        }
+
+        // Reserved; an older packager's -i table past the keyframes is not read
+        index->frame_stride = 0;
+        index->frame_entries = 0;
+        entry->index = (const uint8_t*)index;
+        entry->index_size = sizeof(GbmIndexHeader) + 4 * index->keyframe_count;
+        entry->frame_count = index->frame_count;
+        device_index_used += entry->index_size / 4;
+        return;
     }
+}
 
-    memset(info, 0, sizeof(*info));
+bool media_source_init_device(const MediaBlockDevice* device) {
+    memset(&source_state, 0, sizeof(source_state));
+    catalog_count = 0;
+    device_index_used = 0;
+    source_state.initialized = true;
 
-    // Try GBFS first
-    if (source_state.gbfs && source_state.gbs_count > 0) {
-        size_t total = gbfs_count_objs(source_state.gbfs);
+    GBFS_FILE header;
+    if (!media_stream_mount(device) ||
+        !media_stream_read(0, &header, sizeof(header)) || !is_gbfs(&header)) {
+        return false;
+    }
 
-        for (size_t i = 0; i < total; i++) {
-            char name[32];
-            u32 len;
-            const void* data = gbfs_get_nth_obj(source_state.gbfs, i, name, &len);
-
-            if (data && is_gbs_file(name)) {
-                info->source = MEDIA_SOURCE_GBFS;
-                info->type = MEDIA_TYPE_GBS;
-                info->data = (const uint8_t*)data;
-                info->size = len;
-                strncpy(info->filename, name, sizeof(info->filename) - 1);
-                return true;
-            }
+    // Catalog the GBS and GBM files, reading only their headers
+    for (uint32_t i = 0; i < header.dir_nmemb && catalog_count < MEDIA_CATALOG_MAX; i++) {
+        GBFS_ENTRY file;
+        if (!device_dir_entry(&header, i, &file)) continue;
+
+        MediaEntry* entry = &catalog[catalog_count];
+        memset(entry, 0, sizeof(*entry));
+        memcpy(entry->name, file.name, sizeof(file.name));
+        entry->type = get_file_type(entry->name);
+        entry->offset = file.data_offset;
+        entry->size = file.len;
+
+        u8 file_header[GBM_HEADER_SIZE];    // GBS_HEADER_SIZE too
+        if (entry->type == MEDIA_TYPE_UNKNOWN || entry->size < sizeof(file_header) ||
+            !media_stream_read(entry->offset, file_header, sizeof(file_header))) {
+            continue;
+        }
+
+        if (entry->type == MEDIA_TYPE_GBS && catalog_gbs(entry, file_header)) {
+            source_state.gbs_list[source_state.gbs_count++] = catalog_count++;
+        } else if (entry->type == MEDIA_TYPE_GBM && catalog_gbm(entry, file_header)) {
+            device_frame_index(entry, &header);
+            source_state.gbm_list[source_state.gbm_count++] = catalog_count++;
         }
     }
 
-    return false;
+    if (source_state.gbs_count > 0 || source_state.gbm_count > 0) {
+        source_state.active_type = MEDIA_SOURCE_SDCARD;
+    }
+    return (source_state.active_type != MEDIA_SOURCE_NONE);
 }
 
-bool media_source_find_gbm(MediaSourceInfo* info) {
+// The archive appended to the ROM, read a sector at a time as if it were
+// on a card (see media_source_rom_device)
+static const uint8_t* rom_archive;
+
+static bool rom_device_read(uint32_t sector, uint32_t count, void* dst) {
+    memcpy(dst, rom_archive + sector * MEDIA_SECTOR_SIZE, count * MEDIA_SECTOR_SIZE);
+    return true;
+}
+
+static MediaBlockDevice rom_device = { rom_device_read, 0 };
+
+const MediaBlockDevice* media_source_rom_device(void) {
+    const GBFS_FILE* gbfs = locate_gbfs();
+    if (!gbfs) {
+        gbfs = find_first_gbfs_file(find_first_gbfs_file);
+    }
+    if (!gbfs) return NULL;
+
+    rom_archive = (const uint8_t*)gbfs;
+    rom_device.sector_count = (gbfs->total_len + MEDIA_SECTOR_SIZE - 1) / MEDIA_SECTOR_SIZE;
+    return &rom_device;
+}
+#endif // MEDIA_SOURCE_STREAM
+
+const MediaEntry* media_source_get_entry(MediaFileType type, uint32_t n) {
+    if (type == MEDIA_TYPE_GBS && n < source_state.gbs_count) {
+        return &catalog[source_state.gbs_list[n]];
+    }
+    if (type == MEDIA_TYPE_GBM && n < source_state.gbm_count) {
+        return &catalog[source_state.gbm_list[n]];
+    }
+    return NULL;
+}
+
+// Fill info from the first catalog entry of type
+static bool find_first(MediaFileType type, MediaSourceInfo* info) {
     if (!source_state.initialized || !info) {
         return false;
     }
 
     memset(info, 0, sizeof(*info));
 
-    // Try GBFS first
-    if (source_state.gbfs && source_state.gbm_count > 0) {
-        size_t total = gbfs_count_objs(source_state.gbfs);
-
-        for (size_t i = 0; i < total; i++) {
-            char name[32];
-            u32 len;
-            const void* data = gbfs_get_nth_obj(source_state.gbfs, i, name, &len);
-
-            if (data && is_gbm_file(name)) {
-                info->source = MEDIA_SOURCE_GBFS;
-                info->type = MEDIA_TYPE_GBM;
-                info->data = (const uint8_t*)data;
-                info->size = len;
-                strncpy(info->filename, name, sizeof(info->filename) - 1);
-                return true;
-            }
-        }
+    const MediaEntry* entry = media_source_get_entry(type, 0);
+    if (!entry) {
+        return false;
     }
 
-    return false;
+    info->source = source_state.active_type;
+    info->type = type;
+    info->data = entry->data;
+    info->size = entry->size;
+    strncpy(info->filename, entry->name, sizeof(info->filename) - 1);
+    return true;
+}
+
+bool media_source_find_gbs(MediaSourceInfo* info) {
+    return find_first(MEDIA_TYPE_GBS, info);
+}
+
+bool media_source_find_gbm(MediaSourceInfo* info) {
+    return find_first(MEDIA_TYPE_GBM, info);
 }
 
 bool media_source_load_file(const char* filename, MediaSourceInfo* info) {
@@ -173,10 +382,9 @@ uint32_t media_source_count(MediaFileType type) {
         return 0;
     }
 
-    if (source_state.gbfs) {
-        if (type == MEDIA_TYPE_GBS) return source_state.gbs_count;
-        if (type == MEDIA_TYPE_GBM) return source_state.gbm_count;
-    }
+    // The catalog, from GBFS in ROM or on the block device (empty otherwise)
+    if (type == MEDIA_TYPE_GBS) return source_state.gbs_count;
+    if (type == MEDIA_TYPE_GBM) return source_state.gbm_count;
 
     return 0;
 }
@@ -0,0 +1,312 @@
+/*
+ * Streaming Media Access Implementation
+ *
+ * A chunk cache over a block device, with read-ahead for open streams,
+ * GBM frame staging and a GBS block source for gbs_audio_init_stream.
+ */
+
+#include "media_stream.h"
+
+#if MEDIA_SOURCE_STREAM
+
+#include "gbs_audio.h"
+#include <gba_base.h>
+#include <string.h>
+
+#define SECTORS_PER_CHUNK   (MEDIA_CHUNK_SIZE / MEDIA_SECTOR_SIZE)
+#define CHUNK_NONE          0xFFFFFFFF
+
+// Largest GBM frame: u16 length, then up to 0xFFFE bytes
+#define FRAME_STAGING_SIZE  0x10000
+
+// Largest GBS block (modes 0 and 1)
+#define GBS_BLOCK_MAX       0x400
+
+// One slot is pinned for the audio decoder; loads need another
+#if MEDIA_CACHE_CHUNKS < 2
+#error "MEDIA_CACHE_CHUNKS must be at least 2"
+#endif
+
+// A cache slot: which chunk it holds and when it was last used
+typedef struct {
+    uint32_t tag;           // Device offset / MEDIA_CHUNK_SIZE, or CHUNK_NONE
+    uint32_t used;          // use_clock at the last lookup, for LRU
+} ChunkSlot;
+
+EWRAM_BSS static uint8_t chunk_data[MEDIA_CACHE_CHUNKS][MEDIA_CHUNK_SIZE] __attribute__((aligned(4)));
+EWRAM_BSS static uint8_t frame_staging[FRAME_STAGING_SIZE] __attribute__((aligned(4)));
+
+static ChunkSlot chunks[MEDIA_CACHE_CHUNKS];
+static uint32_t use_clock;
+
+static const MediaBlockDevice* device;
+static uint32_t device_size;        // In bytes
+
+static MediaStream* streams[MEDIA_STREAMS_MAX];
+static uint32_t stream_count;
+
+// Slot the audio decoder is reading a block from in place, or -1. It is
+// never evicted: the block must stay readable until the next fetch.
+static volatile int audio_slot;
+
+static MediaStreamStats stats;
+
+// ============================================================================
+// Chunk Cache
+// ============================================================================
+
+static int find_chunk(uint32_t tag) {
+    for (int i = 0; i < MEDIA_CACHE_CHUNKS; i++) {
+        if (chunks[i].tag == tag) return i;
+    }
+    return -1;
+}
+
+// Whether chunk tag is in some stream's read-ahead window: from the chunk
+// of its position, MEDIA_READAHEAD_CHUNKS on, up to the end of the stream
+static bool chunk_wanted(uint32_t tag) {
+    for (uint32_t i = 0; i < stream_count; i++) {
+        const MediaStream* s = streams[i];
+        if (s->position >= s->size) continue;
+
+        uint32_t first = (s->start + s->position) / MEDIA_CHUNK_SIZE;
+        uint32_t last = (s->start + s->size - 1) / MEDIA_CHUNK_SIZE;
+        if (last > first + MEDIA_READAHEAD_CHUNKS) last = first + MEDIA_READAHEAD_CHUNKS;
+        if (tag >= first && tag <= last) return true;
+    }
+    return false;
+}
+
+// Slot to load into: a free one, else the least recently used chunk no
+// stream is about to read, else the least recently used of all - never
+// the audio decoder's
+static int choose_victim(void) {
+    int victim = -1;
+    int fallback = -1;
+    for (int i = 0; i < MEDIA_CACHE_CHUNKS; i++) {
+        if (chunks[i].tag == CHUNK_NONE) return i;
+        if (i == audio_slot) continue;
+        if (fallback < 0 || chunks[i].used < chunks[fallback].used) fallback = i;
+        if (!chunk_wanted(chunks[i].tag) &&
+            (victim < 0 || chunks[i].used < chunks[victim].used)) {
+            victim = i;
+        }
+    }
+    return victim >= 0 ? victim : fallback;
+}
+
+// Read chunk tag from the device into a slot; -1 on a device error.
+// Main loop only: the audio IRQ never waits on the device.
+static int load_chunk(uint32_t tag) {
+    int slot;
+    for (;;) {
+        slot = choose_victim();
+        uint32_t old_tag = chunks[slot].tag;
+        chunks[slot].tag = CHUNK_NONE;
+        // Once untagged the IRQ cannot find the slot, so it cannot pin it
+        // now; but it may have between the choice and here
+        if (slot != audio_slot) break;
+        chunks[slot].tag = old_tag;
+    }
+
+    uint32_t sector = tag * SECTORS_PER_CHUNK;
+    uint32_t count = device->sector_count - sector;
+    if (count > SECTORS_PER_CHUNK) count = SECTORS_PER_CHUNK;
+    if (!device->read(sector, count, chunk_data[slot])) {
+        return -1;
+    }
+    stats.device_reads++;
+    stats.device_bytes += count * MEDIA_SECTOR_SIZE;
+
+    chunks[slot].tag = tag;
+    chunks[slot].used = ++use_clock;
+    return slot;
+}
+
+// Slot holding chunk tag: from the cache, else (if load) from the device.
+// -1 if it is not resident and cannot be loaded.
+static int get_chunk(uint32_t tag, bool load) {
+    int slot = find_chunk(tag);
+    if (slot >= 0) {
+        stats.hits++;
+        chunks[slot].used = ++use_clock;
+        return slot;
+    }
+    if (!load) return -1;
+
+    stats.misses++;
+    return load_chunk(tag);
+}
+
+// Copy len bytes at device offset, chunk by chunk
+static bool copy_span(uint32_t offset, uint8_t* dst, uint32_t len, bool load) {
+    while (len > 0) {
+        uint32_t in_chunk = offset % MEDIA_CHUNK_SIZE;
+        uint32_t n = MEDIA_CHUNK_SIZE - in_chunk;
+        if (n > len) n = len;
+
+        int slot = get_chunk(offset / MEDIA_CHUNK_SIZE, load);
+        if (slot < 0) return false;
+        memcpy(dst, chunk_data[slot] + in_chunk, n);
+
+        offset += n;
+        dst += n;
+        len -= n;
+    }
+    return true;
+}
+
+bool media_stream_mount(const MediaBlockDevice* dev) {
+    memset(&stats, 0, sizeof(stats));
+    for (int i = 0; i < MEDIA_CACHE_CHUNKS; i++) {
+        chunks[i].tag = CHUNK_NONE;
+        chunks[i].used = 0;
+    }
+    use_clock = 0;
+    stream_count = 0;
+    audio_slot = -1;
+
+    device = dev;
+    if (!dev || !dev->read || dev->sector_count == 0) {
+        device = NULL;
+        return false;
+    }
+    device_size = dev->sector_count * MEDIA_SECTOR_SIZE;
+    return true;
+}
+
+bool media_stream_read(uint32_t offset, void* dst, uint32_t len) {
+    if (!device || offset > device_size || len > device_size - offset) {
+        return false;
+    }
+
+    return copy_span(offset, dst, len, true);
+}
+
+bool media_stream_open(MediaStream* stream, uint32_t start, uint32_t size) {
+    if (stream_count == MEDIA_STREAMS_MAX) return false;
+
+    stream->start = start;
+    stream->size = size;
+    stream->position = 0;
+    streams[stream_count++] = stream;
+    return true;
+}
+
+bool media_stream_prefetch(void) {
+    if (!device) return false;
+
+    bool fetched = false;
+    for (uint32_t i = 0; i < stream_count && !fetched; i++) {
+        const MediaStream* s = streams[i];
+        if (s->position >= s->size) continue;
+
+        uint32_t first = (s->start + s->position) / MEDIA_CHUNK_SIZE;
+        uint32_t last = (s->start + s->size - 1) / MEDIA_CHUNK_SIZE;
+        if (last > first + MEDIA_READAHEAD_CHUNKS) last = first + MEDIA_READAHEAD_CHUNKS;
+
+        // The nearest chunk of the window not yet cached
+        for (uint32_t tag = first; tag <= last; tag++) {
+            if (find_chunk(tag) < 0) {
+                fetched = load_chunk(tag) >= 0;
+                if (fetched) stats.prefetches++;
+                break;
+            }
+        }
+    }
+    return fetched;
+}
+
+void media_stream_get_stats(MediaStreamStats* out) {
+    *out = stats;
+}
+
+// ============================================================================
+// GBM Frames
+// ============================================================================
+
+const uint8_t* media_stream_stage_frame(MediaStream* stream, uint32_t offset) {
+    if (offset + 2 > stream->size) return NULL;
+
+    uint8_t len[2];
+    if (!media_stream_read(stream->start + offset, len, 2)) return NULL;
+
+    uint32_t frame_len = len[0] | (len[1] << 8);
+    if (frame_len == 0 || frame_len == 0xFFFF || offset + 2 + frame_len > stream->size) {
+        return NULL;
+    }
+
+    // Read ahead from the next frame on, then take this one
+    stream->position = offset + 2 + frame_len;
+    if (!media_stream_read(stream->start + offset, frame_staging, 2 + frame_len)) {
+        return NULL;
+    }
+    return frame_staging;
+}
+
+// ============================================================================
+// GBS Blocks
+// ============================================================================
+
+EWRAM_BSS static uint8_t gbs_header[GBS_HEADER_SIZE] __attribute__((aligned(4)));
+
+// Blocks that straddle two chunks are copied here
+EWRAM_BSS static uint8_t gbs_block[GBS_BLOCK_MAX] __attribute__((aligned(4)));
+
+static MediaStream* gbs_stream;
+static uint32_t gbs_block_size;
+static const uint8_t* gbs_last_block;   // Replayed when a block is not to hand
+
+// GbsBlockFetch for the audio stream. A block inside one chunk is used in
+// place and its slot pinned (audio_slot) until the next block is to hand;
+// one that straddles two chunks is copied to gbs_block. The Timer1 IRQ
+// (may_wait clear) only takes cached chunks: a device read there would
+// hold off every interrupt for milliseconds.
+static const uint8_t* fetch_gbs_block(uint32_t block, bool may_wait) {
+    uint32_t offset = GBS_HEADER_SIZE + block * gbs_block_size;
+    uint32_t at = gbs_stream->start + offset;
+    uint32_t in_chunk = at % MEDIA_CHUNK_SIZE;
+
+    const uint8_t* data = NULL;
+    uint32_t tag = at / MEDIA_CHUNK_SIZE;
+    if (in_chunk + gbs_block_size <= MEDIA_CHUNK_SIZE) {
+        int slot = get_chunk(tag, may_wait);
+        if (slot >= 0) {
+            data = chunk_data[slot] + in_chunk;
+            audio_slot = slot;
+        }
+    } else if ((may_wait || (find_chunk(tag) >= 0 && find_chunk(tag + 1) >= 0)) &&
+               copy_span(at, gbs_block, gbs_block_size, may_wait)) {
+        // Both halves are to hand, so gbs_block is only overwritten whole
+        data = gbs_block;
+        audio_slot = -1;
+    }
+
+    if (!data) {
+        stats.audio_replays++;
+        return gbs_last_block;
+    }
+    gbs_stream->position = offset;
+    gbs_last_block = data;
+    return data;
+}
+
+bool media_stream_open_gbs(MediaStream* stream, uint32_t start, uint32_t size) {
+    GbsAudioInfo info;
+    if (size < GBS_HEADER_SIZE || !media_stream_read(start, gbs_header, GBS_HEADER_SIZE) ||
+        !gbs_audio_probe(gbs_header, size, &info) || info.block_size > GBS_BLOCK_MAX) {
+        return false;
+    }
+
+    gbs_stream = stream;
+    gbs_block_size = info.block_size;
+    gbs_last_block = gbs_block;
+    audio_slot = -1;
+    if (!media_stream_open(stream, start, size)) {
+        return false;
+    }
+    stream->position = GBS_HEADER_SIZE;
+    return gbs_audio_init_stream(gbs_header, size, fetch_gbs_block);
+}
+
+#endif // MEDIA_SOURCE_STREAM